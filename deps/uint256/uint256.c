@@ -24,6 +24,19 @@
 
 static const char HEXDIGITS[] = "0123456789abcdef";
 
+#ifdef UINT256_NATIVE_INT128
+__extension__ typedef unsigned __int128 native128_t;
+
+static native128_t toNative(uint128_t *number) {
+    return ((native128_t) UPPER_P(number) << 64) | LOWER_P(number);
+}
+
+static void fromNative(native128_t value, uint128_t *target) {
+    UPPER_P(target) = (uint64_t) (value >> 64);
+    LOWER_P(target) = (uint64_t) value;
+}
+#endif
+
 static uint64_t readUint64BE(uint8_t *buffer) {
     return (((uint64_t) buffer[0]) << 56) | (((uint64_t) buffer[1]) << 48) |
            (((uint64_t) buffer[2]) << 40) | (((uint64_t) buffer[3]) << 32) |
@@ -70,6 +83,9 @@ void clear256(uint256_t *target) {
 }
 
 void shiftl128(uint128_t *number, uint32_t value, uint128_t *target) {
+#ifdef UINT256_NATIVE_INT128
+    fromNative(value >= 128 ? 0 : toNative(number) << value, target);
+#else
     if (value >= 128) {
         clear128(target);
     } else if (value == 64) {
@@ -86,6 +102,7 @@ void shiftl128(uint128_t *number, uint32_t value, uint128_t *target) {
     } else {
         clear128(target);
     }
+#endif
 }
 
 void shiftl256(uint256_t *number, uint32_t value, uint256_t *target) {
@@ -114,6 +131,9 @@ void shiftl256(uint256_t *number, uint32_t value, uint256_t *target) {
 }
 
 void shiftr128(uint128_t *number, uint32_t value, uint128_t *target) {
+#ifdef UINT256_NATIVE_INT128
+    fromNative(value >= 128 ? 0 : toNative(number) >> value, target);
+#else
     if (value >= 128) {
         clear128(target);
     } else if (value == 64) {
@@ -132,6 +152,7 @@ void shiftr128(uint128_t *number, uint32_t value, uint128_t *target) {
     } else {
         clear128(target);
     }
+#endif
 }
 
 void shiftr256(uint256_t *number, uint32_t value, uint256_t *target) {
@@ -231,9 +252,13 @@ bool gte256(uint256_t *number1, uint256_t *number2) {
 }
 
 void add128(uint128_t *number1, uint128_t *number2, uint128_t *target) {
+#ifdef UINT256_NATIVE_INT128
+    fromNative(toNative(number1) + toNative(number2), target);
+#else
     UPPER_P(target) = UPPER_P(number1) + UPPER_P(number2) +
                       ((LOWER_P(number1) + LOWER_P(number2)) < LOWER_P(number1));
     LOWER_P(target) = LOWER_P(number1) + LOWER_P(number2);
+#endif
 }
 
 void add256(uint256_t *number1, uint256_t *number2, uint256_t *target) {
@@ -250,9 +275,13 @@ void add256(uint256_t *number1, uint256_t *number2, uint256_t *target) {
 }
 
 void minus128(uint128_t *number1, uint128_t *number2, uint128_t *target) {
+#ifdef UINT256_NATIVE_INT128
+    fromNative(toNative(number1) - toNative(number2), target);
+#else
     UPPER_P(target) = UPPER_P(number1) - UPPER_P(number2) -
                       ((LOWER_P(number1) - LOWER_P(number2)) > LOWER_P(number1));
     LOWER_P(target) = LOWER_P(number1) - LOWER_P(number2);
+#endif
 }
 
 void minus256(uint256_t *number1, uint256_t *number2, uint256_t *target) {
@@ -279,6 +308,9 @@ void or256(uint256_t *number1, uint256_t *number2, uint256_t *target) {
 }
 
 void mul128(uint128_t *number1, uint128_t *number2, uint128_t *target) {
+#ifdef UINT256_NATIVE_INT128
+    fromNative(toNative(number1) * toNative(number2), target);
+#else
     uint64_t top[4] = {UPPER_P(number1) >> 32,
                        UPPER_P(number1) & 0xffffffff,
                        LOWER_P(number1) >> 32,
@@ -321,103 +353,56 @@ void mul128(uint128_t *number1, uint128_t *number2, uint128_t *target) {
     UPPER(tmp) = 0;
     LOWER(tmp) = fourth32;
     add128(&tmp, &tmp2, target);
+#endif
 }
 
 void mul256(uint256_t *number1, uint256_t *number2, uint256_t *target) {
-    uint128_t top[4];
-    uint128_t bottom[4];
-    uint128_t products[4][4];
-    uint128_t tmp, tmp2, fourth64, third64, second64, first64;
-    uint256_t target1, target2;
-    UPPER(top[0]) = 0;
-    LOWER(top[0]) = UPPER(UPPER_P(number1));
-    UPPER(top[1]) = 0;
-    LOWER(top[1]) = LOWER(UPPER_P(number1));
-    UPPER(top[2]) = 0;
-    LOWER(top[2]) = UPPER(LOWER_P(number1));
-    UPPER(top[3]) = 0;
-    LOWER(top[3]) = LOWER(LOWER_P(number1));
-    UPPER(bottom[0]) = 0;
-    LOWER(bottom[0]) = UPPER(UPPER_P(number2));
-    UPPER(bottom[1]) = 0;
-    LOWER(bottom[1]) = LOWER(UPPER_P(number2));
-    UPPER(bottom[2]) = 0;
-    LOWER(bottom[2]) = UPPER(LOWER_P(number2));
-    UPPER(bottom[3]) = 0;
-    LOWER(bottom[3]) = LOWER(LOWER_P(number2));
-
-    for (int y = 3; y > -1; y--) {
-        for (int x = 3; x > -1; x--) {
-            mul128(&top[x], &bottom[y], &products[3 - x][y]);
+    // schoolbook product of 64-bit limbs, least significant first, truncated to 256 bits
+    uint64_t top[4] = {LOWER(LOWER_P(number1)),
+                       UPPER(LOWER_P(number1)),
+                       LOWER(UPPER_P(number1)),
+                       UPPER(UPPER_P(number1))};
+    uint64_t bottom[4] = {LOWER(LOWER_P(number2)),
+                          UPPER(LOWER_P(number2)),
+                          LOWER(UPPER_P(number2)),
+                          UPPER(UPPER_P(number2))};
+    uint64_t result[4] = {0, 0, 0, 0};
+    uint128_t product, tmp;
+
+    for (int x = 0; x < 4; x++) {
+        uint64_t carry = 0;
+        for (int y = 0; x + y < 4; y++) {
+            // top * bottom + result + carry <= (2^64 - 1)^2 + 2 * (2^64 - 1) fits in 128 bits
+            mul64x64_128(top[x], bottom[y], &product);
+            UPPER(tmp) = 0;
+            LOWER(tmp) = result[x + y];
+            add128(&product, &tmp, &product);
+            LOWER(tmp) = carry;
+            add128(&product, &tmp, &product);
+            result[x + y] = LOWER(product);
+            carry = UPPER(product);
         }
     }
 
-    UPPER(fourth64) = 0;
-    LOWER(fourth64) = LOWER(products[0][3]);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[0][2]);
-    UPPER(tmp2) = 0;
-    LOWER(tmp2) = UPPER(products[0][3]);
-    add128(&tmp, &tmp2, &third64);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[0][1]);
-    UPPER(tmp2) = 0;
-    LOWER(tmp2) = UPPER(products[0][2]);
-    add128(&tmp, &tmp2, &second64);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[0][0]);
-    UPPER(tmp2) = 0;
-    LOWER(tmp2) = UPPER(products[0][1]);
-    add128(&tmp, &tmp2, &first64);
-
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[1][3]);
-    add128(&tmp, &third64, &tmp2);
-    copy128(&third64, &tmp2);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[1][2]);
-    add128(&tmp, &second64, &tmp2);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = UPPER(products[1][3]);
-    add128(&tmp, &tmp2, &second64);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[1][1]);
-    add128(&tmp, &first64, &tmp2);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = UPPER(products[1][2]);
-    add128(&tmp, &tmp2, &first64);
-
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[2][3]);
-    add128(&tmp, &second64, &tmp2);
-    copy128(&second64, &tmp2);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[2][2]);
-    add128(&tmp, &first64, &tmp2);
-    UPPER(tmp) = 0;
-    LOWER(tmp) = UPPER(products[2][3]);
-    add128(&tmp, &tmp2, &first64);
-
-    UPPER(tmp) = 0;
-    LOWER(tmp) = LOWER(products[3][3]);
-    add128(&tmp, &first64, &tmp2);
-    copy128(&first64, &tmp2);
-
-    clear256(&target1);
-    shiftl128(&first64, 64, &UPPER(target1));
-    clear256(&target2);
-    UPPER(UPPER(target2)) = UPPER(third64);
-    shiftl128(&third64, 64, &LOWER(target2));
-    add256(&target1, &target2, target);
-    clear256(&target1);
-    copy128(&UPPER(target1), &second64);
-    add256(&target1, target, &target2);
-    clear256(&target1);
-    copy128(&LOWER(target1), &fourth64);
-    add256(&target1, &target2, target);
+    LOWER(LOWER_P(target)) = result[0];
+    UPPER(LOWER_P(target)) = result[1];
+    LOWER(UPPER_P(target)) = result[2];
+    UPPER(UPPER_P(target)) = result[3];
 }
 
 void divmod128(uint128_t *l, uint128_t *r, uint128_t *retDiv, uint128_t *retMod) {
+    if (zero128(r)) {
+        // no quotient, as for a divisor larger than the dividend
+        copy128(retMod, l);
+        clear128(retDiv);
+        return;
+    }
+#ifdef UINT256_NATIVE_INT128
+    native128_t dividend = toNative(l);
+    native128_t divisor = toNative(r);
+    fromNative(dividend / divisor, retDiv);
+    fromNative(dividend % divisor, retMod);
+#else
     uint128_t copyd, adder, resDiv, resMod;
     uint128_t one;
     UPPER(one) = 0;
@@ -446,11 +431,17 @@ void divmod128(uint128_t *l, uint128_t *r, uint128_t *retDiv, uint128_t *retMod)
         copy128(retDiv, &resDiv);
         copy128(retMod, &resMod);
     }
+#endif
 }
 
 void divmod256(uint256_t *l, uint256_t *r, uint256_t *retDiv, uint256_t *retMod) {
     uint256_t copyd, adder, resDiv, resMod;
     uint256_t one;
+    if (zero256(r)) {
+        copy256(retMod, l);
+        clear256(retDiv);
+        return;
+    }
     clear256(&one);
     UPPER(LOWER(one)) = 0;
     LOWER(LOWER(one)) = 1;
@@ -490,51 +481,174 @@ static void reverseString(char *str, uint32_t length) {
     }
 }
 
-bool tostring128(uint128_t *number, uint32_t baseParam, char *out, uint32_t outLength) {
-    uint128_t rDiv;
-    uint128_t rMod;
-    uint128_t base;
-    copy128(&rDiv, number);
-    clear128(&rMod);
-    clear128(&base);
-    LOWER(base) = baseParam;
-    uint32_t offset = 0;
-    if ((baseParam < 2) || (baseParam > 16)) {
-        return false;
+// divides the two-limb value (u1:u0) by the normalized divisor v (top bit
+// set), u1 < v, using 32-bit half-limbs (Hacker's Delight, divlu). Only used
+// to compute reciprocals, the divisions themselves go through divReciprocal
+static uint64_t divlu(uint64_t u1, uint64_t u0, uint64_t v, uint64_t *r) {
+    const uint64_t b = 1ULL << 32;
+    uint64_t vn1 = v >> 32;
+    uint64_t vn0 = v & 0xFFFFFFFF;
+    uint64_t un1 = u0 >> 32;
+    uint64_t un0 = u0 & 0xFFFFFFFF;
+
+    uint64_t q1 = u1 / vn1;
+    uint64_t rhat = u1 - q1 * vn1;
+    while ((q1 >= b) || (q1 * vn0 > b * rhat + un1)) {
+        q1--;
+        rhat += vn1;
+        if (rhat >= b) {
+            break;
+        }
     }
-    do {
-        if (offset > (outLength - 1)) {
+
+    uint64_t un21 = u1 * b + un1 - q1 * v;
+    uint64_t q0 = un21 / vn1;
+    rhat = un21 - q0 * vn1;
+    while ((q0 >= b) || (q0 * vn0 > b * rhat + un0)) {
+        q0--;
+        rhat += vn1;
+        if (rhat >= b) {
+            break;
+        }
+    }
+
+    *r = un21 * b + un0 - q0 * v;
+    return q1 * b + q0;
+}
+
+void mul64x64_128(uint64_t number1, uint64_t number2, uint128_t *target) {
+#ifdef UINT256_NATIVE_INT128
+    fromNative((native128_t) number1 * number2, target);
+#else
+    uint64_t a1 = number1 >> 32, a0 = number1 & 0xFFFFFFFF;
+    uint64_t b1 = number2 >> 32, b0 = number2 & 0xFFFFFFFF;
+    uint64_t low = a0 * b0;
+    uint64_t mid1 = a1 * b0;
+    uint64_t mid2 = a0 * b1;
+    uint64_t high = a1 * b1;
+    // sum of the middle words, cannot overflow: each term is < 2^32
+    uint64_t mid = (low >> 32) + (mid1 & 0xFFFFFFFF) + (mid2 & 0xFFFFFFFF);
+    UPPER_P(target) = high + (mid1 >> 32) + (mid2 >> 32) + (mid >> 32);
+    LOWER_P(target) = (mid << 32) | (low & 0xFFFFFFFF);
+#endif
+}
+
+void reciprocal64(uint64_t divisor, reciprocal64_t *target) {
+    uint32_t shift = 0;
+    while ((divisor << shift) >> 63 == 0) {
+        shift++;
+    }
+    uint64_t normalized = divisor << shift;
+    uint64_t unused;
+    target->divisor = normalized;
+    target->shift = shift;
+    // floor((2^128 - 1) / normalized) - 2^64
+    target->reciprocal = divlu(~normalized, UINT64_MAX, normalized, &unused);
+}
+
+// divides the two-limb value (u1:u0) by the normalized divisor, u1 < divisor,
+// with one multiplication by the reciprocal (Moller and Granlund, 2011)
+static uint64_t divReciprocal(uint64_t u1, uint64_t u0, const reciprocal64_t *r, uint64_t *rem) {
+    uint128_t q;
+    mul64x64_128(r->reciprocal, u1, &q);
+    uint64_t q0 = LOWER(q) + u0;
+    uint64_t q1 = UPPER(q) + u1 + 1 + (q0 < u0);
+    uint64_t remainder = u0 - q1 * r->divisor;
+    if (remainder > q0) {
+        q1--;
+        remainder += r->divisor;
+    }
+    if (remainder >= r->divisor) {
+        q1++;
+        remainder -= r->divisor;
+    }
+    *rem = remainder;
+    return q1;
+}
+
+// limbs (most significant first) /= divisor, returns the remainder
+static uint64_t divmodLimbs(uint64_t *limbs, uint32_t count, const reciprocal64_t *reciprocal) {
+    uint32_t shift = reciprocal->shift;
+    uint64_t rem = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        // work on the limbs shifted left by `shift`, the remainder stays < divisor
+        uint64_t lo = limbs[i] << shift;
+        uint64_t hi = rem;
+        if (shift != 0) {
+            hi |= limbs[i] >> (64 - shift);
+        }
+        limbs[i] = divReciprocal(hi, lo, reciprocal, &rem);
+    }
+    return rem >> shift;
+}
+
+uint64_t divmod128_reciprocal(uint128_t *number,
+                              const reciprocal64_t *reciprocal,
+                              uint128_t *target) {
+    uint64_t limbs[2] = {UPPER_P(number), LOWER_P(number)};
+    uint64_t rem = divmodLimbs(limbs, 2, reciprocal);
+    UPPER_P(target) = limbs[0];
+    LOWER_P(target) = limbs[1];
+    return rem;
+}
+
+static bool zeroLimbs(uint64_t *limbs, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (limbs[i] != 0) {
             return false;
         }
-        divmod128(&rDiv, &base, &rDiv, &rMod);
-        out[offset++] = HEXDIGITS[(uint8_t) LOWER(rMod)];
-    } while (!zero128(&rDiv));
-    out[offset] = '\0';
-    reverseString(out, offset);
+    }
     return true;
 }
 
-bool tostring256(uint256_t *number, uint32_t baseParam, char *out, uint32_t outLength) {
-    uint256_t rDiv;
-    uint256_t rMod;
-    uint256_t base;
-    copy256(&rDiv, number);
-    clear256(&rMod);
-    clear256(&base);
-    UPPER(LOWER(base)) = 0;
-    LOWER(LOWER(base)) = baseParam;
-    uint32_t offset = 0;
+// Divides by the largest power of the base fitting in 64 bits (10^19 in base
+// 10) and emits every chunk with native 64-bit arithmetic, instead of one
+// full-width division per digit
+static bool limbsToString(uint64_t *limbs,
+                          uint32_t count,
+                          uint32_t baseParam,
+                          char *out,
+                          uint32_t outLength) {
     if ((baseParam < 2) || (baseParam > 16)) {
         return false;
     }
+    uint64_t chunk = baseParam;
+    uint32_t chunkDigits = 1;
+    while (chunk <= UINT64_MAX / baseParam) {
+        chunk *= baseParam;
+        chunkDigits++;
+    }
+    reciprocal64_t reciprocal;
+    reciprocal64(chunk, &reciprocal);
+
+    uint32_t offset = 0;
+    bool last;
     do {
-        if (offset > (outLength - 1)) {
-            return false;
+        uint64_t rem = divmodLimbs(limbs, count, &reciprocal);
+        last = zeroLimbs(limbs, count);
+        // inner chunks are zero padded, the leading one stops at its top digit
+        for (uint32_t i = 0; (i < chunkDigits) && (!last || (rem != 0) || (i == 0)); i++) {
+            if (offset > (outLength - 1)) {
+                return false;
+            }
+            out[offset++] = HEXDIGITS[rem % baseParam];
+            rem /= baseParam;
         }
-        divmod256(&rDiv, &base, &rDiv, &rMod);
-        out[offset++] = HEXDIGITS[(uint8_t) LOWER(LOWER(rMod))];
-    } while (!zero256(&rDiv));
+    } while (!last);
     out[offset] = '\0';
     reverseString(out, offset);
     return true;
 }
+
+bool tostring128(uint128_t *number, uint32_t baseParam, char *out, uint32_t outLength) {
+    uint64_t limbs[2] = {UPPER_P(number), LOWER_P(number)};
+    return limbsToString(limbs, 2, baseParam, out, outLength);
+}
+
+bool tostring256(uint256_t *number, uint32_t baseParam, char *out, uint32_t outLength) {
+    uint64_t limbs[4] = {UPPER(UPPER_P(number)),
+                         LOWER(UPPER_P(number)),
+                         UPPER(LOWER_P(number)),
+                         LOWER(LOWER_P(number))};
+    return limbsToString(limbs, 4, baseParam, out, outLength);
+}
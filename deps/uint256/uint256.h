@@ -23,6 +23,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Host builds use the compiler 128-bit integers for the 128-bit arithmetic,
+// define UINT256_PORTABLE to force the 64-bit limb implementation
+#if defined(__SIZEOF_INT128__) && !defined(UINT256_PORTABLE)
+#define UINT256_NATIVE_INT128
+#endif
+
 typedef struct uint128_t {
     uint64_t elements[2];
 } uint128_t;
@@ -31,6 +37,13 @@ typedef struct uint256_t {
     uint128_t elements[2];
 } uint256_t;
 
+// precomputed reciprocal of a 64-bit divisor, see reciprocal64()
+typedef struct reciprocal64_t {
+    uint64_t divisor;     // divisor shifted left until its top bit is set
+    uint64_t reciprocal;  // floor((2^128 - 1) / divisor) - 2^64
+    uint32_t shift;
+} reciprocal64_t;
+
 #define UPPER_P(x) x->elements[0]
 #define LOWER_P(x) x->elements[1]
 #define UPPER(x)   x.elements[0]
@@ -64,8 +77,14 @@ void or128(uint128_t *number1, uint128_t *number2, uint128_t *target);
 void or256(uint256_t *number1, uint256_t *number2, uint256_t *target);
 void mul128(uint128_t *number1, uint128_t *number2, uint128_t *target);
 void mul256(uint256_t *number1, uint256_t *number2, uint256_t *target);
+// a zero divisor gives a zero quotient and the dividend as the remainder
 void divmod128(uint128_t *l, uint128_t *r, uint128_t *div, uint128_t *mod);
 void divmod256(uint256_t *l, uint256_t *r, uint256_t *div, uint256_t *mod);
+void mul64x64_128(uint64_t number1, uint64_t number2, uint128_t *target);
+void reciprocal64(uint64_t divisor, reciprocal64_t *target);
+uint64_t divmod128_reciprocal(uint128_t *number,
+                              const reciprocal64_t *reciprocal,
+                              uint128_t *target);
 bool tostring128(uint128_t *number, uint32_t base, char *out, uint32_t outLength);
 bool tostring256(uint256_t *number, uint32_t base, char *out, uint32_t outLength);
 
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base64.h"
+#include "bech32.h"
+#include "parse_tx.h"
+#include "provide_ESDT_info.h"
+
+// Host microbenchmarks of the parser, codecs and bignum kernels, linked
+// against the same elrond library as the fuzzers. Results are printed as
+// JSON on stdout so that they can be compared across releases.
+//
+// usage: bench [--min-time <seconds>] [filter]
+
+tx_context_t tx_context;
+tx_hash_context_t tx_hash_context;
+esdt_info_t esdt_info;
+
+// the app receives the transaction in chunks of at most this size
+#define CHUNK_SIZE      255
+#define LARGE_DATA_SIZE 3000
+
+typedef struct {
+    const char *name;
+    void (*run)(const void *arg);
+    const void *arg;
+    size_t bytes_per_op;  // 0 when a throughput makes no sense
+} benchmark_t;
+
+static volatile uint64_t sink;
+static double min_time = 0.5;
+
+#define ADDRESS_1 "erd1qyu5wthldzr8wx5c9ucg8kjagg0jfs53s8nr3zpz3hypefsdd8ssycr6th"
+#define ADDRESS_2 "erd1spyavw0956vq68xj8y4tenjpq2wd5a9p2c6j8gsz7ztyrnpxrruqzu66jx"
+#define ADDRESS_3 "erd1k2s324ww2g0yj38qn2ch2jwctdy8mnfxep94q9arncc6xecg3xaq6mjse8"
+
+static const char TX_PLAIN[] =
+    "{\"nonce\":42,\"value\":\"1000000000000000000\",\"receiver\":\"" ADDRESS_1
+    "\",\"sender\":\"" ADDRESS_2
+    "\",\"gasPrice\":1000000000,\"gasLimit\":50000,\"chainID\":\"1\",\"version\":2,"
+    "\"options\":1}";
+
+// ESDTTransfer@WEGLD-bd4d79@1000000000000000000
+static const char TX_ESDT[] =
+    "{\"nonce\":42,\"value\":\"0\",\"receiver\":\"" ADDRESS_1 "\",\"sender\":\"" ADDRESS_2
+    "\",\"gasPrice\":1000000000,\"gasLimit\":500000,\"data\":"
+    "\"RVNEVFRyYW5zZmVyQDU3NDU0NzRjNDQyZDYyNjQzNDY0MzczOUAwZGUwYjZiM2E3NjQwMDAw\","
+    "\"chainID\":\"1\",\"version\":2,\"options\":1}";
+
+static const char TX_GUARDED[] =
+    "{\"nonce\":42,\"value\":\"1000000000000000000\",\"receiver\":\"" ADDRESS_1
+    "\",\"sender\":\"" ADDRESS_2
+    "\",\"gasPrice\":1000000000,\"gasLimit\":100000,\"chainID\":\"1\",\"version\":2,"
+    "\"options\":2,\"guardian\":\"" ADDRESS_3 "\"}";
+
+static const char TX_RELAYED[] =
+    "{\"nonce\":42,\"value\":\"1000000000000000000\",\"receiver\":\"" ADDRESS_1
+    "\",\"sender\":\"" ADDRESS_2
+    "\",\"gasPrice\":1000000000,\"gasLimit\":100000,\"chainID\":\"1\",\"version\":2,"
+    "\"options\":1,\"relayer\":\"" ADDRESS_3 "\"}";
+
+static char large_data[LARGE_DATA_SIZE / 3 * 4 + 8];
+static char tx_large[sizeof(large_data) + 512];
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void base64encode(char *out, const uint8_t *in, size_t len) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = in[i] << 16;
+        if (i + 1 < len) {
+            v |= in[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            v |= in[i + 2];
+        }
+        out[o++] = alphabet[(v >> 18) & 0x3F];
+        out[o++] = alphabet[(v >> 12) & 0x3F];
+        out[o++] = i + 1 < len ? alphabet[(v >> 6) & 0x3F] : '=';
+        out[o++] = i + 2 < len ? alphabet[v & 0x3F] : '=';
+    }
+    out[o] = '\0';
+}
+
+// a smart contract call with many hex arguments
+static void build_large_tx(void) {
+    char raw[LARGE_DATA_SIZE + 1];
+    size_t len = snprintf(raw, sizeof(raw), "multiTokenSwap");
+    for (uint32_t i = 0; len + 17 < LARGE_DATA_SIZE; i++) {
+        len += snprintf(raw + len, sizeof(raw) - len, "@%016x", i * 0x9E3779B9u);
+    }
+    base64encode(large_data, (const uint8_t *) raw, len);
+    snprintf(tx_large,
+             sizeof(tx_large),
+             "{\"nonce\":42,\"value\":\"0\",\"receiver\":\"" ADDRESS_1 "\",\"sender\":\"" ADDRESS_2
+             "\",\"gasPrice\":1000000000,\"gasLimit\":60000000,\"data\":\"%s\","
+             "\"chainID\":\"1\",\"version\":2,\"options\":1}",
+             large_data);
+}
+
+static uint16_t parse_tx(const char *tx) {
+    size_t len = strlen(tx);
+    uint16_t err = MSG_OK;
+    memset(&tx_context, 0, sizeof(tx_context));
+    memset(&tx_hash_context, 0, sizeof(tx_hash_context));
+    tx_hash_context.status = JSON_IDLE;
+    for (size_t offset = 0; offset < len && err == MSG_OK; offset += CHUNK_SIZE) {
+        size_t chunk = len - offset < CHUNK_SIZE ? len - offset : CHUNK_SIZE;
+        err = parse_data((const uint8_t *) tx + offset, chunk);
+    }
+    return err;
+}
+
+static void run_parse_data(const void *arg) {
+    sink += parse_tx(arg);
+}
+
+static void run_parse_esdt(const void *arg) {
+    sink += parse_tx(arg);
+    sink += parse_esdt_data();
+}
+
+static void run_base64decode(const void *arg) {
+    static char decoded[LARGE_DATA_SIZE];
+    sink += base64decode(decoded, arg, strlen(arg));
+}
+
+static void run_gas_to_fee(const void *arg) {
+    (void) arg;
+    uint128_t fee;
+    gas_to_fee(60000000, 1000000000, (uint32_t) (sink & 0xFF), &fee);
+    sink += LOWER(fee);
+}
+
+static void run_format_amount(const void *arg) {
+    uint128_t value = *(const uint128_t *) arg;
+    char out[MAX_AMOUNT_LEN + PRETTY_SIZE];
+    sink += format_amount(&value, 18, "EGLD", out, sizeof(out));
+}
+
+static void run_tostring128(const void *arg) {
+    uint128_t value = *(const uint128_t *) arg;
+    char out[40];
+    sink += tostring128(&value, 10, out, sizeof(out));
+}
+
+static void run_parse_hex(const void *arg) {
+    uint128_t value;
+    sink += parse_hex(arg, strlen(arg), &value);
+    sink += LOWER(value);
+}
+
+static void run_bech32(const void *arg) {
+    char out[FULL_ADDRESS_LENGTH];
+    bech32EncodeFromBytes(out, "erd", arg, 32);
+    sink += (uint8_t) out[10];
+}
+
+// runs the benchmark for at least min_time and returns the time per op
+static double measure(const benchmark_t *b, uint64_t *iterations) {
+    uint64_t n = 1;
+    for (;;) {
+        double start = now();
+        for (uint64_t i = 0; i < n; i++) {
+            b->run(b->arg);
+        }
+        double elapsed = now() - start;
+        if (elapsed >= min_time) {
+            *iterations = n;
+            return elapsed / n;
+        }
+        // aim slightly past min_time for the next round
+        n = elapsed > 0 ? (uint64_t) (n * 1.2 * min_time / elapsed) + 1 : n * 10;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    build_large_tx();
+    esdt_info.valid = true;
+    esdt_info.decimals = 18;
+    memcpy(esdt_info.ticker, "WEGLD", sizeof("WEGLD"));
+    esdt_info.ticker_len = strlen("WEGLD");
+
+    static const uint128_t amount = {{0x36, 0x35C9ADC5DEA00000}};  // 1000 * 10^18
+    static const uint128_t max_value = {{UINT64_MAX, UINT64_MAX}};
+    static const uint8_t public_key[32] = {
+        0x01, 0x39, 0x47, 0x2e, 0xff, 0x68, 0x86, 0x77, 0x1a, 0x98, 0x2f,
+        0x30, 0x83, 0xda, 0x5d, 0x42, 0x1f, 0x24, 0xc2, 0x91, 0x81, 0xe6,
+        0x38, 0x88, 0x22, 0x8d, 0xc8, 0x1c, 0xa6, 0x0d, 0x69, 0xe1,
+    };
+
+    const benchmark_t benchmarks[] = {
+        {"parse_data/plain", run_parse_data, TX_PLAIN, sizeof(TX_PLAIN) - 1},
+        {"parse_data/esdt", run_parse_esdt, TX_ESDT, sizeof(TX_ESDT) - 1},
+        {"parse_data/guarded", run_parse_data, TX_GUARDED, sizeof(TX_GUARDED) - 1},
+        {"parse_data/relayed", run_parse_data, TX_RELAYED, sizeof(TX_RELAYED) - 1},
+        {"parse_data/large_data", run_parse_data, tx_large, strlen(tx_large)},
+        {"base64decode", run_base64decode, large_data, strlen(large_data)},
+        {"gas_to_fee", run_gas_to_fee, NULL, 0},
+        {"format_amount", run_format_amount, &amount, 0},
+        {"tostring128/amount", run_tostring128, &amount, 0},
+        {"tostring128/max", run_tostring128, &max_value, 0},
+        {"parse_hex", run_parse_hex, "0de0b6b3a76400000de0b6b3a7640000", 32},
+        {"bech32EncodeFromBytes", run_bech32, public_key, 32},
+    };
+
+    // the corpora must parse, otherwise the numbers measure an early error
+    const char *corpora[] = {TX_PLAIN, TX_ESDT, TX_GUARDED, TX_RELAYED, tx_large};
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        uint16_t err = parse_tx(corpora[i]);
+        if (err != MSG_OK) {
+            fprintf(stderr, "corpus %zu does not parse: 0x%04x\n", i, err);
+            return 1;
+        }
+    }
+
+    printf("{\n  \"benchmarks\": [");
+    bool first = true;
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        const benchmark_t *b = &benchmarks[i];
+        if (filter != NULL && strstr(b->name, filter) == NULL) {
+            continue;
+        }
+        uint64_t iterations;
+        double seconds = measure(b, &iterations);
+        printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f",
+               first ? "" : ",",
+               b->name,
+               (unsigned long long) iterations,
+               seconds * 1e9);
+        if (b->bytes_per_op != 0) {
+            printf(", \"bytes_per_second\": %.0f", b->bytes_per_op / seconds);
+        }
+        printf("}");
+        first = false;
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "swar.h"
+
+// Checks the SWAR kernels against byte-at-a-time references. Every byte
+// value is tried at every position of a word, so all the lanes of the word
+// tricks see every input; the suite is also built with SWAR_SCALAR.
+
+__extension__ typedef unsigned __int128 u128;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char *name, unsigned int value, size_t position) {
+    if (!ok) {
+        if (failures < 20) {
+            printf("%s mismatch for byte 0x%02x at %zu\n", name, value, position);
+        }
+        failures++;
+    }
+}
+
+static bool ref_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool ref_is_hex_digit(char c) {
+    return ref_is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool ref_parse_u64(const char *str, size_t len, uint64_t *result) {
+    u128 n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!ref_is_digit(str[i])) {
+            return false;
+        }
+        n = n * 10 + (str[i] - '0');
+        if (n > UINT64_MAX) {
+            return false;
+        }
+    }
+    *result = (uint64_t) n;
+    return true;
+}
+
+static void check_digits(const char *str, size_t len, unsigned int value, size_t position) {
+    bool valid = true;
+    for (size_t i = 0; i < len; i++) {
+        valid = valid && ref_is_digit(str[i]);
+    }
+    check(swar_is_digits(str, len) == valid, "swar_is_digits", value, position);
+
+    uint64_t expected = 0, result = 0;
+    bool ok = ref_parse_u64(str, len, &expected);
+    check(swar_parse_u64(str, len, &result) == ok && (!ok || result == expected),
+          "swar_parse_u64",
+          value,
+          position);
+}
+
+static void check_hex(const char *str, size_t len, unsigned int value, size_t position) {
+    bool valid = true;
+    for (size_t i = 0; i < len; i++) {
+        valid = valid && ref_is_hex_digit(str[i]);
+    }
+    check(swar_is_hex_digits(str, len) == valid, "swar_is_hex_digits", value, position);
+
+    if (valid && len >= 8) {
+        uint32_t expected = 0;
+        for (size_t i = 0; i < 8; i++) {
+            expected = (expected << 4) | swar_hex_value(str[i]);
+        }
+        check(swar_hex8_value(str) == expected, "swar_hex8_value", value, position);
+    }
+}
+
+static void check_encode(const uint8_t *src, size_t len, unsigned int value, size_t position) {
+    char out[64];
+    char expected[64];
+    for (int uppercase = 0; uppercase < 2; uppercase++) {
+        const char *hex = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+        for (size_t i = 0; i < len; i++) {
+            expected[2 * i] = hex[src[i] >> 4];
+            expected[2 * i + 1] = hex[src[i] & 0x0F];
+        }
+        swar_hex_encode(out, src, len, uppercase);
+        check(memcmp(out, expected, 2 * len) == 0, "swar_hex_encode", value, position);
+    }
+}
+
+int main(void) {
+#ifdef SWAR_SCALAR
+    printf("swar: scalar kernels\n");
+#else
+    printf("swar: word kernels\n");
+#endif
+    // every byte at every position, lengths covering full words and tails
+    const char *digits = "1234567890123456789012345";
+    const char *hex = "0123456789abcdefABCDEF0123";
+    for (size_t len = 0; len <= 25; len++) {
+        for (size_t position = 0; position < len; position++) {
+            for (unsigned int value = 0; value < 256; value++) {
+                char str[32];
+                memcpy(str, digits, len);
+                str[position] = (char) value;
+                check_digits(str, len, value, position);
+
+                memcpy(str, hex, len);
+                str[position] = (char) value;
+                check_hex(str, len, value, position);
+
+                uint8_t bytes[32];
+                memset(bytes, 0xA5, sizeof(bytes));
+                bytes[position] = (uint8_t) value;
+                check_encode(bytes, len, value, position);
+            }
+        }
+    }
+
+    // every pair of adjacent bytes of an encoded word
+    for (unsigned int value = 0; value < 65536; value++) {
+        uint8_t bytes[4] = {value >> 8, value & 0xFF, value & 0xFF, value >> 8};
+        check_encode(bytes, 4, value, 0);
+    }
+
+    // overflow boundaries of the 64-bit parse
+    const char *bounds[] = {
+        "18446744073709551615",
+        "18446744073709551616",
+        "18446744073709551625",
+        "18446744083709551615",
+        "55000000000000000000",
+        "99999999999999999999",
+        "00000000000000000000018446744073709551615",
+        "00000000000000000000018446744073709551616",
+        "1844674407370955161",
+        "",
+    };
+    for (size_t i = 0; i < sizeof(bounds) / sizeof(bounds[0]); i++) {
+        check_digits(bounds[i], strlen(bounds[i]), 0, i);
+    }
+
+    printf("%u failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
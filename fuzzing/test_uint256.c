@@ -0,0 +1,298 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "uint256.h"
+
+// Checks the uint256 library against the compiler 128-bit integers. The
+// suite is built once per backend, so both agree with the same reference.
+
+#define ITERATIONS 200000
+// 256 binary digits and the terminating NUL
+#define DIGITS_BUFFER_SIZE 257
+
+__extension__ typedef unsigned __int128 u128;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static unsigned int failures = 0;
+
+static uint64_t next_random(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// random limbs biased toward the edge cases of the carry and shift code
+static uint64_t random_limb(void) {
+    uint64_t r = next_random();
+    switch (next_random() % 6) {
+        case 0:
+            return 0;
+        case 1:
+            return UINT64_MAX - (r % 3);
+        case 2:
+            return r >> (r % 64);
+        case 3:
+            return r % 1000;
+        default:
+            return r;
+    }
+}
+
+static void random128(uint128_t *target) {
+    UPPER_P(target) = random_limb();
+    LOWER_P(target) = random_limb();
+}
+
+static void random256(uint256_t *target) {
+    random128(&UPPER_P(target));
+    random128(&LOWER_P(target));
+}
+
+static u128 to_u128(uint128_t *number) {
+    return ((u128) UPPER_P(number) << 64) | LOWER_P(number);
+}
+
+static void check(bool ok, const char *name, unsigned int iteration) {
+    if (!ok) {
+        if (failures < 20) {
+            printf("%s mismatch at iteration %u\n", name, iteration);
+        }
+        failures++;
+    }
+}
+
+// 256-bit values as four 64-bit limbs, least significant first
+static void to_limbs(uint256_t *number, uint64_t limbs[4]) {
+    limbs[0] = LOWER(LOWER_P(number));
+    limbs[1] = UPPER(LOWER_P(number));
+    limbs[2] = LOWER(UPPER_P(number));
+    limbs[3] = UPPER(UPPER_P(number));
+}
+
+// reference conversion: long division of the limbs by the base, least significant digit first
+static void tostring_reference(const uint64_t number[4], uint32_t base, char *out) {
+    uint64_t limbs[4];
+    char digits[DIGITS_BUFFER_SIZE];
+    size_t len = 0;
+
+    memcpy(limbs, number, sizeof(limbs));
+    do {
+        u128 rem = 0;
+        for (int k = 3; k >= 0; k--) {
+            u128 current = (rem << 64) | limbs[k];
+            limbs[k] = (uint64_t) (current / base);
+            rem = current % base;
+        }
+        digits[len++] = "0123456789abcdef"[rem];
+    } while (limbs[0] != 0 || limbs[1] != 0 || limbs[2] != 0 || limbs[3] != 0);
+    for (size_t k = 0; k < len; k++) {
+        out[k] = digits[len - 1 - k];
+    }
+    out[len] = '\0';
+}
+
+static void check_tostring128(uint128_t *number, uint32_t base, const char *name, unsigned int i) {
+    uint64_t limbs[4] = {LOWER_P(number), UPPER_P(number), 0, 0};
+    char out[DIGITS_BUFFER_SIZE];
+    char expected[DIGITS_BUFFER_SIZE];
+
+    tostring_reference(limbs, base, expected);
+    check(tostring128(number, base, out, sizeof(out)) && strcmp(out, expected) == 0, name, i);
+}
+
+static void check_tostring256(uint256_t *number, uint32_t base, const char *name, unsigned int i) {
+    uint64_t limbs[4];
+    char out[DIGITS_BUFFER_SIZE];
+    char expected[DIGITS_BUFFER_SIZE];
+
+    to_limbs(number, limbs);
+    tostring_reference(limbs, base, expected);
+    check(tostring256(number, base, out, sizeof(out)) && strcmp(out, expected) == 0, name, i);
+}
+
+static void mul256_reference(uint256_t *a, uint256_t *b, uint64_t result[4]) {
+    uint64_t x[4], y[4];
+    to_limbs(a, x);
+    to_limbs(b, y);
+    memset(result, 0, 4 * sizeof(uint64_t));
+    for (int i = 0; i < 4; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; i + j < 4; j++) {
+            u128 t = (u128) x[i] * y[j] + result[i + j] + carry;
+            result[i + j] = (uint64_t) t;
+            carry = (uint64_t) (t >> 64);
+        }
+    }
+}
+
+static void test128(unsigned int i) {
+    uint128_t a, b, r, q, m;
+    random128(&a);
+    random128(&b);
+    u128 x = to_u128(&a);
+    u128 y = to_u128(&b);
+
+    add128(&a, &b, &r);
+    check(to_u128(&r) == x + y, "add128", i);
+    minus128(&a, &b, &r);
+    check(to_u128(&r) == x - y, "minus128", i);
+    mul128(&a, &b, &r);
+    check(to_u128(&r) == x * y, "mul128", i);
+
+    uint32_t shift = next_random() % 140;
+    shiftl128(&a, shift, &r);
+    check(to_u128(&r) == (shift >= 128 ? 0 : x << shift), "shiftl128", i);
+    shiftr128(&a, shift, &r);
+    check(to_u128(&r) == (shift >= 128 ? 0 : x >> shift), "shiftr128", i);
+
+    if (!zero128(&b)) {
+        divmod128(&a, &b, &q, &m);
+        check(to_u128(&q) == x / y && to_u128(&m) == x % y, "divmod128", i);
+    }
+
+    check(gt128(&a, &b) == (x > y), "gt128", i);
+    check(equal128(&a, &a) && equal128(&a, &b) == (x == y), "equal128", i);
+
+    // in place operations, as used by the callers
+    copy128(&r, &a);
+    add128(&r, &b, &r);
+    check(to_u128(&r) == x + y, "add128 in place", i);
+    copy128(&r, &a);
+    mul128(&r, &b, &r);
+    check(to_u128(&r) == x * y, "mul128 in place", i);
+    if (!zero128(&b)) {
+        copy128(&q, &a);
+        divmod128(&q, &b, &q, &m);
+        check(to_u128(&q) == x / y && to_u128(&m) == x % y, "divmod128 in place", i);
+    }
+
+    mul64x64_128(LOWER(a), LOWER(b), &r);
+    check(to_u128(&r) == (u128) LOWER(a) * LOWER(b), "mul64x64_128", i);
+
+    uint64_t divisor = random_limb();
+    if (divisor != 0) {
+        reciprocal64_t reciprocal;
+        reciprocal64(divisor, &reciprocal);
+        uint64_t rem = divmod128_reciprocal(&a, &reciprocal, &q);
+        check(to_u128(&q) == x / divisor && rem == x % divisor, "divmod128_reciprocal", i);
+    }
+
+    check_tostring128(&a, 2 + next_random() % 15, "tostring128", i);
+    check_tostring128(&a, 10, "tostring128 decimal", i);
+}
+
+static void test256(unsigned int i) {
+    uint256_t a, b, r, q, m, t;
+    uint64_t x[4], y[4], z[4];
+    random256(&a);
+    random256(&b);
+    to_limbs(&a, x);
+    to_limbs(&b, y);
+
+    add256(&a, &b, &r);
+    to_limbs(&r, z);
+    u128 carry = 0;
+    bool ok = true;
+    for (int k = 0; k < 4; k++) {
+        carry += (u128) x[k] + y[k];
+        ok = ok && z[k] == (uint64_t) carry;
+        carry >>= 64;
+    }
+    check(ok, "add256", i);
+
+    // a - b + b == a
+    minus256(&a, &b, &t);
+    add256(&t, &b, &r);
+    check(equal256(&r, &a), "minus256", i);
+
+    // shifting left then right only keeps the low bits
+    uint32_t shift = next_random() % 256;
+    shiftl256(&a, shift, &t);
+    shiftr256(&t, shift, &r);
+    shiftl256(&r, shift, &q);
+    check(equal256(&q, &t), "shift256", i);
+
+    mul256(&a, &b, &r);
+    mul256_reference(&a, &b, z);
+    to_limbs(&r, x);
+    check(memcmp(x, z, sizeof(z)) == 0, "mul256", i);
+    copy256(&r, &a);
+    mul256(&r, &b, &r);
+    to_limbs(&r, x);
+    check(memcmp(x, z, sizeof(z)) == 0, "mul256 in place", i);
+
+    check_tostring256(&a, 2 + next_random() % 15, "tostring256", i);
+    check_tostring256(&a, 10, "tostring256 decimal", i);
+
+    if (!zero256(&b)) {
+        // q * b + m == a with m < b
+        divmod256(&a, &b, &q, &m);
+        mul256_reference(&q, &b, z);
+        LOWER(LOWER(t)) = z[0];
+        UPPER(LOWER(t)) = z[1];
+        LOWER(UPPER(t)) = z[2];
+        UPPER(UPPER(t)) = z[3];
+        add256(&t, &m, &r);
+        check(equal256(&r, &a) && gt256(&b, &m), "divmod256", i);
+    }
+}
+
+// the conversions go through chunks of 19 decimal digits, check the values around a chunk
+static void test_tostring_edges(void) {
+    const uint64_t chunk = 10000000000000000000ULL;  // 10^19
+    const uint64_t edges[][2] = {{0, 0}, {0, chunk - 1}, {0, chunk}, {UINT64_MAX, UINT64_MAX}};
+
+    for (unsigned int k = 0; k < sizeof(edges) / sizeof(edges[0]); k++) {
+        uint128_t a;
+        uint256_t b;
+        UPPER(a) = edges[k][0];
+        LOWER(a) = edges[k][1];
+        clear256(&b);
+        copy128(&LOWER(b), &a);
+        if (UPPER(a) == UINT64_MAX) {
+            // the largest value of each width
+            copy128(&UPPER(b), &a);
+        }
+        for (uint32_t base = 2; base <= 16; base++) {
+            check_tostring128(&a, base, "tostring128 edge", k);
+            check_tostring256(&b, base, "tostring256 edge", k);
+        }
+    }
+}
+
+// a zero divisor must not trap with the native backend nor loop with the portable one
+static void test_divide_by_zero(void) {
+    for (unsigned int k = 0; k < 16; k++) {
+        uint128_t a, divisor128, q128, m128;
+        uint256_t b, divisor256, q256, m256;
+        random128(&a);
+        random256(&b);
+        clear128(&divisor128);
+        clear256(&divisor256);
+
+        divmod128(&a, &divisor128, &q128, &m128);
+        check(zero128(&q128) && equal128(&m128, &a), "divmod128 by zero", k);
+        divmod256(&b, &divisor256, &q256, &m256);
+        check(zero256(&q256) && equal256(&m256, &b), "divmod256 by zero", k);
+    }
+}
+
+int main(void) {
+#ifdef UINT256_NATIVE_INT128
+    printf("uint256: native 128-bit backend\n");
+#else
+    printf("uint256: portable backend\n");
+#endif
+    test_tostring_edges();
+    test_divide_by_zero();
+    for (unsigned int i = 0; i < ITERATIONS; i++) {
+        test128(i);
+        test256(i);
+    }
+    printf("%u failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
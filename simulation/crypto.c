@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/params.h>
+
+#include "cx.h"
+
+// Software versions of the cryptographic syscalls used by the app. Keccak is
+// implemented here (OpenSSL only has the padded SHA-3), the rest is OpenSSL.
+// The keys are derived from the same default mnemonic as Speculos, so the
+// addresses and signatures match the ones of the emulator; it can be changed
+// with the SIMULATION_MNEMONIC environment variable.
+
+#define DEFAULT_MNEMONIC                                                               \
+    "glory promote mansion idle axis finger extra february uncover one trip resource " \
+    "lawn turtle enact monster seven myth punch hobby comfort wild raise skin"
+
+#define KECCAK_ROUNDS   24
+#define ED25519_KEY_LEN 32
+#define SEED_LEN        64
+
+static const uint64_t keccak_round_constants[KECCAK_ROUNDS] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL,
+};
+
+static const uint8_t keccak_rotations[25] = {
+    0, 1, 62, 28, 27, 36, 44, 6, 55, 20, 3, 10, 43, 25, 39, 41, 45, 15, 21, 8, 18, 2, 61, 56, 14,
+};
+
+static uint64_t rotl64(uint64_t x, unsigned int n) {
+    return n == 0 ? x : (x << n) | (x >> (64 - n));
+}
+
+static void keccak_f1600(uint64_t state[25]) {
+    for (int round = 0; round < KECCAK_ROUNDS; round++) {
+        uint64_t c[5], b[25];
+        // theta
+        for (int x = 0; x < 5; x++) {
+            c[x] = state[x] ^ state[x + 5] ^ state[x + 10] ^ state[x + 15] ^ state[x + 20];
+        }
+        for (int x = 0; x < 5; x++) {
+            uint64_t d = c[(x + 4) % 5] ^ rotl64(c[(x + 1) % 5], 1);
+            for (int y = 0; y < 25; y += 5) {
+                state[x + y] ^= d;
+            }
+        }
+        // rho and pi
+        for (int x = 0; x < 5; x++) {
+            for (int y = 0; y < 5; y++) {
+                b[y + 5 * ((2 * x + 3 * y) % 5)] = rotl64(state[x + 5 * y],
+                                                          keccak_rotations[x + 5 * y]);
+            }
+        }
+        // chi
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; x++) {
+                state[x + y] = b[x + y] ^ (~b[(x + 1) % 5 + y] & b[(x + 2) % 5 + y]);
+            }
+        }
+        // iota
+        state[0] ^= keccak_round_constants[round];
+    }
+}
+
+static void keccak_absorb_block(cx_sha3_t *hash) {
+    for (size_t i = 0; i < hash->block_size / 8; i++) {
+        uint64_t lane = 0;
+        for (int k = 7; k >= 0; k--) {
+            lane = (lane << 8) | hash->block[8 * i + k];
+        }
+        hash->state[i] ^= lane;
+    }
+    keccak_f1600(hash->state);
+    hash->block_length = 0;
+}
+
+static void keccak_update(cx_sha3_t *hash, const uint8_t *in, size_t len) {
+    while (len > 0) {
+        size_t chunk = hash->block_size - hash->block_length;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(hash->block + hash->block_length, in, chunk);
+        hash->block_length += chunk;
+        in += chunk;
+        len -= chunk;
+        if (hash->block_length == hash->block_size) {
+            keccak_absorb_block(hash);
+        }
+    }
+}
+
+static void keccak_final(cx_sha3_t *hash, uint8_t *out) {
+    // original Keccak padding, as used by the chain, not the SHA-3 one
+    memset(hash->block + hash->block_length, 0, hash->block_size - hash->block_length);
+    hash->block[hash->block_length] ^= 0x01;
+    hash->block[hash->block_size - 1] ^= 0x80;
+    keccak_absorb_block(hash);
+    for (size_t i = 0; i < hash->output_size; i++) {
+        out[i] = (uint8_t) (hash->state[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+cx_err_t cx_keccak_init_no_throw(cx_sha3_t *hash, size_t size) {
+    if (size != 224 && size != 256 && size != 384 && size != 512) {
+        return CX_INVALID_PARAMETER;
+    }
+    memset(hash, 0, sizeof(*hash));
+    hash->header.algorithm = CX_KECCAK;
+    hash->output_size = size / 8;
+    hash->block_size = 200 - 2 * hash->output_size;
+    return CX_OK;
+}
+
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash) {
+    hash->header.algorithm = CX_SHA256;
+    hash->context = EVP_MD_CTX_new();
+    if (hash->context == NULL || EVP_DigestInit_ex(hash->context, EVP_sha256(), NULL) != 1) {
+        return CX_INTERNAL_ERROR;
+    }
+    return CX_OK;
+}
+
+int cx_sha256_init(cx_sha256_t *hash) {
+    if (cx_sha256_init_no_throw(hash) != CX_OK) {
+        THROW(EXCEPTION);
+    }
+    return CX_SHA256;
+}
+
+cx_err_t cx_hash_no_throw(cx_hash_t *hash,
+                          uint32_t mode,
+                          const uint8_t *in,
+                          size_t len,
+                          uint8_t *out,
+                          size_t out_len) {
+    switch (hash->algorithm) {
+        case CX_KECCAK: {
+            cx_sha3_t *sha3 = (cx_sha3_t *) hash;
+            keccak_update(sha3, in, len);
+            if (mode & CX_LAST) {
+                if (out_len < sha3->output_size) {
+                    return CX_INVALID_PARAMETER;
+                }
+                keccak_final(sha3, out);
+            }
+            return CX_OK;
+        }
+        case CX_SHA256: {
+            cx_sha256_t *sha256 = (cx_sha256_t *) hash;
+            if (EVP_DigestUpdate(sha256->context, in, len) != 1) {
+                return CX_INTERNAL_ERROR;
+            }
+            if (mode & CX_LAST) {
+                if (out_len < 32 || EVP_DigestFinal_ex(sha256->context, out, NULL) != 1) {
+                    return CX_INVALID_PARAMETER;
+                }
+                EVP_MD_CTX_free(sha256->context);
+                sha256->context = NULL;
+            }
+            return CX_OK;
+        }
+        default:
+            return CX_INVALID_PARAMETER;
+    }
+}
+
+cx_err_t cx_ecfp_init_private_key_no_throw(cx_curve_t curve,
+                                           const uint8_t *raw_key,
+                                           size_t key_len,
+                                           cx_ecfp_private_key_t *private_key) {
+    if (curve != CX_CURVE_Ed25519 || key_len != ED25519_KEY_LEN) {
+        return CX_INVALID_PARAMETER;
+    }
+    private_key->curve = curve;
+    private_key->d_len = key_len;
+    memcpy(private_key->d, raw_key, key_len);
+    return CX_OK;
+}
+
+cx_err_t cx_ecfp_init_public_key_no_throw(cx_curve_t curve,
+                                          const uint8_t *raw_key,
+                                          size_t key_len,
+                                          cx_ecfp_public_key_t *public_key) {
+    if (key_len > sizeof(public_key->W)) {
+        return CX_INVALID_PARAMETER;
+    }
+    public_key->curve = curve;
+    public_key->W_len = key_len;
+    memcpy(public_key->W, raw_key, key_len);
+    return CX_OK;
+}
+
+static EVP_PKEY *ed25519_key(const cx_ecfp_private_key_t *private_key) {
+    if (private_key->curve != CX_CURVE_Ed25519 || private_key->d_len != ED25519_KEY_LEN) {
+        return NULL;
+    }
+    return EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, private_key->d, ED25519_KEY_LEN);
+}
+
+// Ed25519 public keys come out of the device as 04 || x || y, both coordinates
+// big endian; only the bytes read by the app are filled: y and the parity of x
+cx_err_t cx_ecfp_generate_pair_no_throw(cx_curve_t curve,
+                                        cx_ecfp_public_key_t *public_key,
+                                        cx_ecfp_private_key_t *private_key,
+                                        bool keep_private) {
+    uint8_t compressed[ED25519_KEY_LEN];
+    size_t compressed_len = sizeof(compressed);
+
+    if (curve != CX_CURVE_Ed25519 || !keep_private) {
+        return CX_INVALID_PARAMETER;
+    }
+    EVP_PKEY *key = ed25519_key(private_key);
+    if (key == NULL) {
+        return CX_INVALID_PARAMETER;
+    }
+    int ok = EVP_PKEY_get_raw_public_key(key, compressed, &compressed_len);
+    EVP_PKEY_free(key);
+    if (ok != 1) {
+        return CX_INTERNAL_ERROR;
+    }
+
+    memset(public_key, 0, sizeof(*public_key));
+    public_key->curve = curve;
+    public_key->W_len = sizeof(public_key->W);
+    public_key->W[0] = 0x04;
+    public_key->W[32] = compressed[31] >> 7;
+    for (int i = 0; i < ED25519_KEY_LEN; i++) {
+        public_key->W[64 - i] = compressed[i];
+    }
+    public_key->W[33] &= 0x7F;
+    return CX_OK;
+}
+
+cx_err_t cx_eddsa_sign_no_throw(const cx_ecfp_private_key_t *private_key,
+                                cx_md_t hash_id,
+                                const uint8_t *hash,
+                                size_t hash_len,
+                                uint8_t *signature,
+                                size_t signature_len) {
+    if (hash_id != CX_SHA512 || signature_len < 64) {
+        return CX_INVALID_PARAMETER;
+    }
+    EVP_PKEY *key = ed25519_key(private_key);
+    if (key == NULL) {
+        return CX_INVALID_PARAMETER;
+    }
+    EVP_MD_CTX *context = EVP_MD_CTX_new();
+    int ok = context != NULL && EVP_DigestSignInit(context, NULL, NULL, NULL, key) == 1 &&
+             EVP_DigestSign(context, signature, &signature_len, hash, hash_len) == 1;
+    EVP_MD_CTX_free(context);
+    EVP_PKEY_free(key);
+    return ok ? CX_OK : CX_INTERNAL_ERROR;
+}
+
+bool cx_ecdsa_verify_no_throw(const cx_ecfp_public_key_t *public_key,
+                              const uint8_t *hash,
+                              size_t hash_len,
+                              const uint8_t *signature,
+                              size_t signature_len) {
+    EVP_PKEY *key = NULL;
+    EVP_PKEY_CTX *context;
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_PKEY_PARAM_GROUP_NAME, "secp256k1", 0),
+        OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PUB_KEY,
+                                          (void *) public_key->W,
+                                          public_key->W_len),
+        OSSL_PARAM_construct_end(),
+    };
+
+    if (public_key->curve != CX_CURVE_256K1) {
+        return false;
+    }
+    context = EVP_PKEY_CTX_new_from_name(NULL, "EC", NULL);
+    if (context == NULL || EVP_PKEY_fromdata_init(context) != 1 ||
+        EVP_PKEY_fromdata(context, &key, EVP_PKEY_PUBLIC_KEY, params) != 1) {
+        EVP_PKEY_CTX_free(context);
+        return false;
+    }
+    EVP_PKEY_CTX_free(context);
+
+    context = EVP_PKEY_CTX_new(key, NULL);
+    bool ok = context != NULL && EVP_PKEY_verify_init(context) == 1 &&
+              EVP_PKEY_verify(context, signature, signature_len, hash, hash_len) == 1;
+    EVP_PKEY_CTX_free(context);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+// BIP39 seed of the mnemonic, without passphrase
+static bool mnemonic_seed(uint8_t seed[SEED_LEN]) {
+    static uint8_t cached_seed[SEED_LEN];
+    static bool cached = false;
+
+    if (!cached) {
+        const char *mnemonic = getenv("SIMULATION_MNEMONIC");
+        if (mnemonic == NULL) {
+            mnemonic = DEFAULT_MNEMONIC;
+        }
+        if (PKCS5_PBKDF2_HMAC(mnemonic,
+                              strlen(mnemonic),
+                              (const unsigned char *) "mnemonic",
+                              strlen("mnemonic"),
+                              2048,
+                              EVP_sha512(),
+                              SEED_LEN,
+                              cached_seed) != 1) {
+            return false;
+        }
+        cached = true;
+    }
+    memcpy(seed, cached_seed, SEED_LEN);
+    return true;
+}
+
+// SLIP-0010 derivation over ed25519, where only hardened indexes exist
+int os_derive_bip32_with_seed_no_throw(unsigned int derivation_mode,
+                                       unsigned int curve,
+                                       const uint32_t *path,
+                                       unsigned int path_length,
+                                       unsigned char *private_key,
+                                       unsigned char *chain,
+                                       unsigned char *seed,
+                                       unsigned int seed_length) {
+    uint8_t node[64];
+    uint8_t data[1 + ED25519_KEY_LEN + 4];
+    uint8_t master_seed[SEED_LEN];
+    unsigned int node_len = sizeof(node);
+
+    if (derivation_mode != HDW_ED25519_SLIP10 || curve != CX_CURVE_Ed25519) {
+        return CX_INVALID_PARAMETER;
+    }
+    if (seed == NULL) {
+        if (!mnemonic_seed(master_seed)) {
+            return CX_INTERNAL_ERROR;
+        }
+        seed = master_seed;
+        seed_length = sizeof(master_seed);
+    }
+
+    if (HMAC(EVP_sha512(), "ed25519 seed", 12, seed, seed_length, node, &node_len) == NULL) {
+        return CX_INTERNAL_ERROR;
+    }
+    for (unsigned int i = 0; i < path_length; i++) {
+        if ((path[i] & 0x80000000) == 0) {
+            return CX_INVALID_PARAMETER;
+        }
+        data[0] = 0x00;
+        memcpy(data + 1, node, ED25519_KEY_LEN);
+        data[33] = path[i] >> 24;
+        data[34] = path[i] >> 16;
+        data[35] = path[i] >> 8;
+        data[36] = path[i];
+        if (HMAC(EVP_sha512(), node + 32, 32, data, sizeof(data), node, &node_len) == NULL) {
+            return CX_INTERNAL_ERROR;
+        }
+    }
+
+    memcpy(private_key, node, ED25519_KEY_LEN);
+    if (chain != NULL) {
+        memcpy(chain, node + 32, 32);
+    }
+    explicit_bzero(node, sizeof(node));
+    explicit_bzero(data, sizeof(data));
+    explicit_bzero(master_seed, sizeof(master_seed));
+    return CX_OK;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Host stand-in for the cryptography API of the SDK, backed by the software
+// implementations of simulation/crypto.c.
+
+#include "os.h"
+
+typedef uint32_t cx_err_t;
+
+#define CX_OK                0
+#define CX_INVALID_PARAMETER 0xFFFFFF82
+#define CX_INTERNAL_ERROR    0xFFFFFF85
+
+#define CX_LAST (1 << 0)
+
+typedef enum {
+    CX_NONE,
+    CX_SHA256,
+    CX_SHA512,
+    CX_KECCAK,
+} cx_md_t;
+
+typedef enum {
+    CX_CURVE_NONE,
+    CX_CURVE_256K1,
+    CX_CURVE_Ed25519,
+} cx_curve_t;
+
+typedef struct {
+    cx_md_t algorithm;
+} cx_hash_t;
+
+typedef struct {
+    cx_hash_t header;
+    size_t output_size;
+    size_t block_size;
+    size_t block_length;
+    uint8_t block[200];
+    uint64_t state[25];
+} cx_sha3_t;
+
+typedef struct {
+    cx_hash_t header;
+    void *context;
+} cx_sha256_t;
+
+typedef struct {
+    cx_curve_t curve;
+    size_t d_len;
+    uint8_t d[64];
+} cx_ecfp_private_key_t;
+
+typedef struct {
+    cx_curve_t curve;
+    size_t W_len;
+    uint8_t W[65];
+} cx_ecfp_public_key_t;
+
+cx_err_t cx_keccak_init_no_throw(cx_sha3_t *hash, size_t size);
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash);
+int cx_sha256_init(cx_sha256_t *hash);
+cx_err_t cx_hash_no_throw(cx_hash_t *hash,
+                          uint32_t mode,
+                          const uint8_t *in,
+                          size_t len,
+                          uint8_t *out,
+                          size_t out_len);
+
+cx_err_t cx_ecfp_init_private_key_no_throw(cx_curve_t curve,
+                                           const uint8_t *raw_key,
+                                           size_t key_len,
+                                           cx_ecfp_private_key_t *private_key);
+cx_err_t cx_ecfp_init_public_key_no_throw(cx_curve_t curve,
+                                          const uint8_t *raw_key,
+                                          size_t key_len,
+                                          cx_ecfp_public_key_t *public_key);
+cx_err_t cx_ecfp_generate_pair_no_throw(cx_curve_t curve,
+                                        cx_ecfp_public_key_t *public_key,
+                                        cx_ecfp_private_key_t *private_key,
+                                        bool keep_private);
+cx_err_t cx_eddsa_sign_no_throw(const cx_ecfp_private_key_t *private_key,
+                                cx_md_t hash_id,
+                                const uint8_t *hash,
+                                size_t hash_len,
+                                uint8_t *signature,
+                                size_t signature_len);
+bool cx_ecdsa_verify_no_throw(const cx_ecfp_public_key_t *public_key,
+                              const uint8_t *hash,
+                              size_t hash_len,
+                              const uint8_t *signature,
+                              size_t signature_len);
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "nbgl_use_case.h"
+
+extern const nbgl_icon_details_t C_icon_multiversx_logo_64x64;
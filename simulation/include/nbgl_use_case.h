@@ -0,0 +1,114 @@
+#pragma once
+
+// Host stand-in for the NBGL use cases. Nothing is drawn: the review screens
+// record their callbacks, which the simulated io_exchange then runs as if the
+// user approved everything (see simulation/shim.c).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FIRST_USER_TOKEN 20
+#define INIT_HOME_PAGE   0xff
+
+typedef enum { OFF_STATE, ON_STATE } nbgl_state_t;
+typedef enum { TUNE_TAP_CASUAL } tune_index_e;
+typedef enum { SWITCHES_LIST, INFOS_LIST } nbgl_contentType_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+} nbgl_icon_details_t;
+
+typedef void (*nbgl_callback_t)(void);
+typedef void (*nbgl_choiceCallback_t)(bool confirm);
+typedef void (*nbgl_contentActionCallback_t)(int token, uint8_t index, int page);
+
+typedef struct {
+    const char *item;
+    const char *value;
+} nbgl_layoutTagValue_t;
+
+typedef nbgl_layoutTagValue_t *(*nbgl_layoutTagValueCallback_t)(uint8_t pairIndex);
+
+typedef struct {
+    nbgl_layoutTagValue_t *pairs;
+    nbgl_layoutTagValueCallback_t callback;  // gives the pairs when pairs is NULL
+    uint8_t nbPairs;
+    uint8_t startIndex;
+    uint8_t nbMaxLinesForValue;
+    bool smallCaseForValue;
+    bool wrapping;
+} nbgl_layoutTagValueList_t;
+
+typedef struct {
+    const char *text;
+    const nbgl_icon_details_t *icon;
+    const char *longPressText;
+    uint8_t longPressToken;
+    tune_index_e tuneId;
+} nbgl_pageInfoLongPress_t;
+
+typedef struct {
+    const char *text;
+    const char *subText;
+    nbgl_state_t initState;
+    uint8_t token;
+    tune_index_e tuneId;
+} nbgl_layoutSwitch_t;
+
+typedef struct {
+    const nbgl_layoutSwitch_t *switches;
+    uint8_t nbSwitches;
+} nbgl_contentSwitchesList_t;
+
+typedef struct {
+    const char *const *infoTypes;
+    const char *const *infoContents;
+    uint8_t nbInfos;
+} nbgl_contentInfoList_t;
+
+typedef struct {
+    nbgl_contentType_t type;
+    union {
+        nbgl_contentSwitchesList_t switchesList;
+        nbgl_contentInfoList_t infosList;
+    } content;
+    nbgl_contentActionCallback_t contentActionCallback;
+} nbgl_content_t;
+
+typedef struct {
+    bool callbackCallNeeded;
+    const nbgl_content_t *contentsList;
+    uint8_t nbContents;
+} nbgl_genericContents_t;
+
+void nbgl_useCaseHomeAndSettings(const char *appName,
+                                 const nbgl_icon_details_t *appIcon,
+                                 const char *tagline,
+                                 uint8_t initSettingPage,
+                                 const nbgl_genericContents_t *settingContents,
+                                 const nbgl_contentInfoList_t *infosList,
+                                 const void *action,
+                                 nbgl_callback_t quitCallback);
+void nbgl_useCaseReviewStart(const nbgl_icon_details_t *icon,
+                             const char *reviewTitle,
+                             const char *reviewSubTitle,
+                             const char *rejectText,
+                             nbgl_callback_t continueCallback,
+                             nbgl_callback_t rejectCallback);
+void nbgl_useCaseStaticReview(const nbgl_layoutTagValueList_t *tagValueList,
+                              const nbgl_pageInfoLongPress_t *infoLongPress,
+                              const char *rejectText,
+                              nbgl_choiceCallback_t callback);
+void nbgl_useCaseAddressReview(const char *address,
+                               const nbgl_layoutTagValueList_t *additionalTagValueList,
+                               const nbgl_icon_details_t *icon,
+                               const char *reviewTitle,
+                               const char *reviewSubTitle,
+                               nbgl_choiceCallback_t choiceCallback);
+void nbgl_useCaseConfirm(const char *message,
+                         const char *subMessage,
+                         const char *confirmText,
+                         const char *rejectText,
+                         nbgl_callback_t callback);
+void nbgl_useCaseStatus(const char *message, bool isSuccess, nbgl_callback_t quitCallback);
@@ -0,0 +1,131 @@
+#pragma once
+
+// Host stand-in for the parts of the BOLOS os.h used by the app. The
+// exception macros follow the SDK ones: every TRY pushes a setjmp context on a
+// chain and THROW longjmps to the innermost one.
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef unsigned short exception_t;
+
+typedef struct try_context_s {
+    jmp_buf jmp_buf;
+    struct try_context_s *previous;
+    exception_t ex;
+} try_context_t;
+
+try_context_t *try_context_get(void);
+try_context_t *try_context_set(try_context_t *context);
+void os_longjmp(unsigned int exception) __attribute__((noreturn));
+
+#define BEGIN_TRY_L(L) \
+    {                  \
+        try_context_t __try##L;
+
+#define TRY_L(L)                                \
+    __try##L.ex = setjmp(__try##L.jmp_buf);     \
+    if (__try##L.ex == 0) {                     \
+        __try##L.previous = try_context_set(&__try##L);
+
+#define CATCH_L(L, x)                       \
+    goto __FINALLY##L;                      \
+    }                                       \
+    else if (__try##L.ex == (x)) {          \
+        __try##L.ex = 0;                    \
+        try_context_set(__try##L.previous);
+
+#define CATCH_OTHER_L(L, e)                 \
+    goto __FINALLY##L;                      \
+    }                                       \
+    else {                                  \
+        exception_t e;                      \
+        e = __try##L.ex;                    \
+        __try##L.ex = 0;                    \
+        try_context_set(__try##L.previous);
+
+#define CATCH_ALL_L(L)                      \
+    goto __FINALLY##L;                      \
+    }                                       \
+    else {                                  \
+        __try##L.ex = 0;                    \
+        try_context_set(__try##L.previous);
+
+#define FINALLY_L(L)                             \
+    goto __FINALLY##L;                           \
+    }                                            \
+    __FINALLY##L:                                \
+    if (try_context_get() == &__try##L) {        \
+        try_context_set(__try##L.previous);      \
+    }
+
+#define END_TRY_L(L)                  \
+    if (__try##L.ex != 0) {           \
+        THROW_L(L, __try##L.ex);      \
+    }                                 \
+    }
+
+#define THROW_L(L, x) os_longjmp(x)
+
+#define BEGIN_TRY      BEGIN_TRY_L(_)
+#define TRY            TRY_L(_)
+#define CATCH(x)       CATCH_L(_, x)
+#define CATCH_OTHER(e) CATCH_OTHER_L(_, e)
+#define CATCH_ALL      CATCH_ALL_L(_)
+#define FINALLY        FINALLY_L(_)
+#define END_TRY        END_TRY_L(_)
+#define THROW(x)       THROW_L(_, x)
+
+#define EXCEPTION          1
+#define INVALID_PARAMETER  2
+#define EXCEPTION_IO_RESET 16
+
+#define U2BE(buf, off) ((((buf)[off] & 0xFF) << 8) | ((buf)[(off) + 1] & 0xFF))
+#define U4BE(buf, off) ((U2BE(buf, off) << 16) | (U2BE(buf, (off) + 2) & 0xFFFF))
+
+#define ARRAYLEN(array) (sizeof(array) / sizeof(array[0]))
+#define PIC(x)          (x)
+
+#ifndef UNUSED
+#define UNUSED(x) (void) x
+#endif
+
+#ifndef PRINTF
+#define PRINTF(...)
+#endif
+
+#define CHANNEL_APDU     0
+#define CHANNEL_KEYBOARD 1
+#define CHANNEL_SPI      2
+
+#define IO_RESET_AFTER_REPLIED 0x80
+#define IO_RECEIVE_DATA        0x40
+#define IO_RETURN_AFTER_TX     0x20
+#define IO_ASYNCH_REPLY        0x10
+#define IO_FLAGS               0xF0
+
+#define IO_APDU_BUFFER_SIZE 260
+
+extern unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len);
+
+void os_boot(void);
+void os_sched_exit(int exit_code) __attribute__((noreturn));
+void reset(void);
+void nvm_write(void *dst_address, void *src_address, unsigned int src_length);
+
+#define HDW_NORMAL         0
+#define HDW_ED25519_SLIP10 1
+
+int os_derive_bip32_with_seed_no_throw(unsigned int derivation_mode,
+                                       unsigned int curve,
+                                       const uint32_t *path,
+                                       unsigned int path_length,
+                                       unsigned char *private_key,
+                                       unsigned char *chain,
+                                       unsigned char *seed,
+                                       unsigned int seed_length);
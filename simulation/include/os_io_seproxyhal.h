@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for the SE proxy HAL. The simulation never receives events,
+// io_exchange reads the APDUs from stdin instead (see simulation/shim.c).
+
+#include "os.h"
+
+#define SEPROXYHAL_TAG_BUTTON_PUSH_EVENT             0x05
+#define SEPROXYHAL_TAG_TICKER_EVENT                  0x0E
+#define SEPROXYHAL_TAG_STATUS_EVENT                  0x15
+#define SEPROXYHAL_TAG_DISPLAY_PROCESSED_EVENT       0x0D
+#define SEPROXYHAL_TAG_FINGER_EVENT                  0x0C
+#define SEPROXYHAL_TAG_STATUS_EVENT_FLAG_USB_POWERED 0x00000008
+
+typedef enum {
+    IO_APDU_MEDIA_NONE,
+    IO_APDU_MEDIA_USB_HID,
+} io_apdu_media_t;
+
+extern io_apdu_media_t G_io_apdu_media;
+
+void io_seproxyhal_init(void);
+void io_seproxyhal_general_status(void);
+unsigned int io_seproxyhal_spi_is_status_sent(void);
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length);
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer,
+                                      unsigned short max_length,
+                                      unsigned int flags);
+void USB_power(unsigned char enabled);
@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for the UX state of the SDK: the simulation builds the NBGL
+// flavour of the app, whose screens are the use cases of nbgl_use_case.h.
+
+#include "os.h"
+
+typedef struct {
+    unsigned int stack_count;
+} ux_state_t;
+
+typedef struct {
+    unsigned int ux_id;
+} bolos_ux_params_t;
+
+extern ux_state_t G_ux;
+extern bolos_ux_params_t G_ux_params;
+
+#define ux G_ux
+
+#define UX_INIT()                  memset(&G_ux, 0, sizeof(G_ux))
+#define UX_FINGER_EVENT(buffer)    (void) (buffer)
+#define UX_TICKER_EVENT(buffer, callback) \
+    do {                                  \
+        (void) (buffer);                  \
+    } while (0)
+#define UX_DEFAULT_EVENT()
@@ -0,0 +1,282 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "glyphs.h"
+#include "nbgl_use_case.h"
+#include "os.h"
+#include "os_io_seproxyhal.h"
+
+// Host implementation of the OS, IO and UI services the app relies on.
+//
+// io_exchange reads one APDU per line of stdin, in hex, and writes every
+// response (data and status word) as one hex line on stdout. Blank lines and
+// lines starting with '#' are skipped, and the app exits at the end of the
+// input. The review screens are auto-approved: their callbacks are queued and
+// run before the next APDU is read, as a user confirming right away would.
+
+#define MAX_PENDING_CALLBACKS 4
+
+typedef struct {
+    nbgl_callback_t callback;
+    nbgl_choiceCallback_t choice;
+} pending_callback_t;
+
+unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+io_apdu_media_t G_io_apdu_media = IO_APDU_MEDIA_USB_HID;
+const nbgl_icon_details_t C_icon_multiversx_logo_64x64 = {64, 64};
+
+static try_context_t *current_try_context;
+static pending_callback_t pending_callbacks[MAX_PENDING_CALLBACKS];
+static size_t pending_count;
+
+try_context_t *try_context_get(void) {
+    return current_try_context;
+}
+
+try_context_t *try_context_set(try_context_t *context) {
+    try_context_t *previous = current_try_context;
+    current_try_context = context;
+    return previous;
+}
+
+void os_longjmp(unsigned int exception) {
+    if (current_try_context == NULL) {
+        fprintf(stderr, "uncaught exception 0x%04x\n", exception);
+        abort();
+    }
+    longjmp(current_try_context->jmp_buf, exception);
+}
+
+void os_boot(void) {
+    current_try_context = NULL;
+}
+
+void os_sched_exit(int exit_code) {
+    (void) exit_code;
+    exit(EXIT_SUCCESS);
+}
+
+void reset(void) {
+    exit(EXIT_SUCCESS);
+}
+
+// the storage lives in a const object, which is in flash on the device
+void nvm_write(void *dst_address, void *src_address, unsigned int src_length) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) dst_address & ~(uintptr_t) (page_size - 1);
+    uintptr_t end = (uintptr_t) dst_address + src_length;
+
+    if (mprotect((void *) start, end - start, PROT_READ | PROT_WRITE) != 0) {
+        perror("nvm_write");
+        abort();
+    }
+    memmove(dst_address, src_address, src_length);
+}
+
+void io_seproxyhal_init(void) {
+}
+
+void io_seproxyhal_general_status(void) {
+}
+
+unsigned int io_seproxyhal_spi_is_status_sent(void) {
+    return 1;
+}
+
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length) {
+    (void) buffer;
+    (void) length;
+}
+
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer,
+                                      unsigned short max_length,
+                                      unsigned int flags) {
+    (void) buffer;
+    (void) max_length;
+    (void) flags;
+    return 0;
+}
+
+void USB_power(unsigned char enabled) {
+    (void) enabled;
+}
+
+static void write_response(unsigned short length) {
+    for (unsigned short i = 0; i < length; i++) {
+        printf("%02x", G_io_apdu_buffer[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = tolower(c);
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// reads the next APDU of stdin into the IO buffer, exits at the end of input
+static unsigned short read_apdu(void) {
+    char line[2 * IO_APDU_BUFFER_SIZE + 64];
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        unsigned short length = 0;
+        int high = -1;
+        const char *c = line;
+
+        while (isspace((unsigned char) *c)) {
+            c++;
+        }
+        if (*c == '\0' || *c == '#') {
+            continue;
+        }
+        for (; *c != '\0'; c++) {
+            if (isspace((unsigned char) *c)) {
+                continue;
+            }
+            int value = hex_value(*c);
+            if (value < 0 || (high < 0 && length == sizeof(G_io_apdu_buffer))) {
+                fprintf(stderr, "invalid APDU: %s", line);
+                exit(EXIT_FAILURE);
+            }
+            if (high < 0) {
+                high = value;
+            } else {
+                G_io_apdu_buffer[length++] = (high << 4) | value;
+                high = -1;
+            }
+        }
+        if (high >= 0) {
+            fprintf(stderr, "odd number of hex digits: %s", line);
+            exit(EXIT_FAILURE);
+        }
+        return length;
+    }
+    exit(EXIT_SUCCESS);
+}
+
+static void push_pending(nbgl_callback_t callback, nbgl_choiceCallback_t choice) {
+    if (pending_count == MAX_PENDING_CALLBACKS) {
+        fprintf(stderr, "too many pending UI callbacks\n");
+        abort();
+    }
+    pending_callbacks[pending_count].callback = callback;
+    pending_callbacks[pending_count].choice = choice;
+    pending_count++;
+}
+
+// plays the user: every screen is confirmed, which may queue the next one
+static void run_pending_callbacks(void) {
+    while (pending_count > 0) {
+        pending_callback_t pending = pending_callbacks[0];
+        pending_count--;
+        memmove(pending_callbacks, pending_callbacks + 1, pending_count * sizeof(pending));
+        if (pending.choice != NULL) {
+            pending.choice(true);
+        } else if (pending.callback != NULL) {
+            pending.callback();
+        }
+    }
+}
+
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len) {
+    if (tx_len != 0 && (channel_and_flags & IO_ASYNCH_REPLY) == 0) {
+        write_response(tx_len);
+    }
+    if (channel_and_flags & IO_RETURN_AFTER_TX) {
+        return 0;
+    }
+    run_pending_callbacks();
+    return read_apdu();
+}
+
+void nbgl_useCaseHomeAndSettings(const char *appName,
+                                 const nbgl_icon_details_t *appIcon,
+                                 const char *tagline,
+                                 uint8_t initSettingPage,
+                                 const nbgl_genericContents_t *settingContents,
+                                 const nbgl_contentInfoList_t *infosList,
+                                 const void *action,
+                                 nbgl_callback_t quitCallback) {
+    (void) appName;
+    (void) appIcon;
+    (void) tagline;
+    (void) initSettingPage;
+    (void) settingContents;
+    (void) infosList;
+    (void) action;
+    (void) quitCallback;
+}
+
+void nbgl_useCaseReviewStart(const nbgl_icon_details_t *icon,
+                             const char *reviewTitle,
+                             const char *reviewSubTitle,
+                             const char *rejectText,
+                             nbgl_callback_t continueCallback,
+                             nbgl_callback_t rejectCallback) {
+    (void) icon;
+    (void) reviewTitle;
+    (void) reviewSubTitle;
+    (void) rejectText;
+    (void) rejectCallback;
+    push_pending(continueCallback, NULL);
+}
+
+void nbgl_useCaseStaticReview(const nbgl_layoutTagValueList_t *tagValueList,
+                              const nbgl_pageInfoLongPress_t *infoLongPress,
+                              const char *rejectText,
+                              nbgl_choiceCallback_t callback) {
+    // go through the pairs given by a callback, as paging through the review would
+    if (tagValueList->pairs == NULL) {
+        for (uint8_t i = tagValueList->startIndex; i < tagValueList->nbPairs; i++) {
+            const nbgl_layoutTagValue_t *pair = tagValueList->callback(i);
+            if (pair->item == NULL || pair->value == NULL) {
+                fprintf(stderr, "missing review pair %u\n", i);
+                abort();
+            }
+        }
+    }
+    (void) infoLongPress;
+    (void) rejectText;
+    push_pending(NULL, callback);
+}
+
+void nbgl_useCaseAddressReview(const char *address,
+                               const nbgl_layoutTagValueList_t *additionalTagValueList,
+                               const nbgl_icon_details_t *icon,
+                               const char *reviewTitle,
+                               const char *reviewSubTitle,
+                               nbgl_choiceCallback_t choiceCallback) {
+    (void) address;
+    (void) additionalTagValueList;
+    (void) icon;
+    (void) reviewTitle;
+    (void) reviewSubTitle;
+    push_pending(NULL, choiceCallback);
+}
+
+void nbgl_useCaseConfirm(const char *message,
+                         const char *subMessage,
+                         const char *confirmText,
+                         const char *rejectText,
+                         nbgl_callback_t callback) {
+    (void) message;
+    (void) subMessage;
+    (void) confirmText;
+    (void) rejectText;
+    push_pending(callback, NULL);
+}
+
+void nbgl_useCaseStatus(const char *message, bool isSuccess, nbgl_callback_t quitCallback) {
+    (void) message;
+    (void) isSuccess;
+    (void) quitCallback;
+}
@@ -2,9 +2,13 @@
 #include <stdint.h>
 
 #include "bech32.h"
+#include "bittools.h"
 #include "get_private_key.h"
 #include "globals.h"
 #include "os.h"
+#include "perf_stats.h"
+#include "segwit_addr.h"
+#include "swar.h"
 #include "ux.h"
 
 /* return false in case of error, true otherwise */
@@ -18,7 +22,9 @@ bool get_public_key(uint32_t account_number, uint32_t index, uint8_t *public_key
         return false;
     }
 
+    PERF_STATS_START(PERF_SECTION_PUBLIC_KEY);
     ret_code = cx_ecfp_generate_pair_no_throw(CX_CURVE_Ed25519, &public_key, &private_key, 1);
+    PERF_STATS_STOP(PERF_SECTION_PUBLIC_KEY);
     if (ret_code != 0) {
         error = true;
     }
@@ -41,14 +47,7 @@ bool get_public_key(uint32_t account_number, uint32_t index, uint8_t *public_key
 // TODO: maybe make this function more general and extract to a new file binary
 // <-> hex converters
 void get_address_hex_from_binary(const uint8_t *public_key, char *address) {
-    const char hex[16] =
-        {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
-    uint8_t i;
-
-    for (i = 0; i < 32; i++) {
-        address[i * 2] = hex[public_key[i] >> 4];
-        address[i * 2 + 1] = hex[public_key[i] & 0xf];
-    }
+    swar_hex_encode(address, public_key, 32, false);
     address[64] = '\0';
 }
 
@@ -60,3 +59,23 @@ void get_address_bech32_from_binary(const uint8_t *public_key, char *address) {
     buffer[32] = '\0';
     bech32EncodeFromBytes(address, HRP, buffer, 33);
 }
+
+bool get_binary_from_address_bech32(const char *address, uint8_t *public_key) {
+    // bech32_decode splits at the last '1', the human readable part may be longer than HRP
+    char hrp[BECH32_ADDRESS_LEN];
+    uint8_t data[BECH32_ADDRESS_LEN];
+    uint8_t key[PUBLIC_KEY_LEN + 1];
+    size_t data_len = 0;
+    size_t key_len = 0;
+
+    if (strnlen(address, BECH32_ADDRESS_LEN + 1) != BECH32_ADDRESS_LEN ||
+        strncmp(address, HRP "1", sizeof(HRP)) != 0) {
+        return false;
+    }
+    if (!bech32_decode(hrp, data, &data_len, address) ||
+        !convert_bits(key, &key_len, 8, data, data_len, 5, 0) || key_len != PUBLIC_KEY_LEN) {
+        return false;
+    }
+    memmove(public_key, key, PUBLIC_KEY_LEN);
+    return true;
+}
@@ -8,5 +8,7 @@
 bool get_public_key(uint32_t account_number, uint32_t index, uint8_t *public_key_array);
 void get_address_hex_from_binary(const uint8_t *public_key, char *address);
 void get_address_bech32_from_binary(const uint8_t *public_key, char *address);
+// get_binary_from_address_bech32 gives the public key of an "erd1..." address, false if invalid
+bool get_binary_from_address_bech32(const char *address, uint8_t *public_key);
 
 #endif
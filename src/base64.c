@@ -0,0 +1,61 @@
+#include "base64.h"
+
+/*
+This implementation is based on the documentation found at
+https://en.wikipedia.org/wiki/Base64
+*/
+
+#define XX BASE64_INVALID
+#define PD BASE64_PAD
+
+// 6-bit value of each base64 character, indexed by the character itself
+// clang-format off
+const uint8_t BASE64_DECODE_TABLE[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, PD, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+// clang-format on
+
+#undef XX
+#undef PD
+
+// decode base64 data, replacing non-printable characters with '?'. Characters
+// are validated and decoded in the same pass, one quad at a time
+bool base64decode(char *decoded, const char *source, size_t len) {
+    const uint8_t *src = (const uint8_t *) source;
+
+    for (size_t i = 0; i < len / 4; i++) {
+        uint8_t a = BASE64_DECODE_TABLE[src[0]];
+        uint8_t b = BASE64_DECODE_TABLE[src[1]];
+        uint8_t c = BASE64_DECODE_TABLE[src[2]];
+        uint8_t d = BASE64_DECODE_TABLE[src[3]];
+        if ((a | b | c | d) & BASE64_INVALID) {
+            return false;
+        }
+        // padding decodes to 0, like any other character outside of the data
+        uint32_t data = ((uint32_t)(a & BASE64_VALUE_MASK) << 18) |
+                        ((uint32_t)(b & BASE64_VALUE_MASK) << 12) |
+                        ((uint32_t)(c & BASE64_VALUE_MASK) << 6) | (d & BASE64_VALUE_MASK);
+        decoded[0] = BASE64_DISPLAY_CHAR(data >> 16);
+        decoded[1] = BASE64_DISPLAY_CHAR(data >> 8);
+        decoded[2] = BASE64_DISPLAY_CHAR(data);
+        decoded += 3;
+        src += 4;
+    }
+    *decoded = '\0';
+    return true;
+}
@@ -6,6 +6,8 @@ typedef enum { NETWORK_MAINNET = 0, NETWORK_TESTNET = 1 } network_t;
 
 typedef enum { CONTRACT_DATA_ENABLED = true, CONTRACT_DATA_DISABLED = false } contract_data_t;
 
+typedef enum { HASH_SIGNING_ENABLED = true, HASH_SIGNING_DISABLED = false } hash_signing_t;
+
 #define MSG_OK                     0x9000
 #define ERR_USER_DENIED            0x6985
 #define ERR_UNKNOWN_INSTRUCTION    0x6D00  // unknown INS
@@ -30,6 +32,9 @@ typedef enum { CONTRACT_DATA_ENABLED = true, CONTRACT_DATA_DISABLED = false } co
 #define ERR_INVALID_ESDT_SIGNATURE 0x6E12
 #define ERR_INDEX_OUT_OF_BOUNDS    0x6E13
 #define ERR_INVALID_ESDT           0x6E14
+#define ERR_HASH_SIGNING_DISABLED  0x6E15  // signTxHashOnly
+#define ERR_NOT_PLAIN_TRANSFER     0x6E16  // signTxBatch
+#define ERR_SPENDING_LIMIT         0x6E17  // signTxBatch
 
 #define FULL_ADDRESS_LENGTH 65  // hex address is 64 characters + \0 = 65
 #define BIP32_PATH          5
@@ -51,15 +56,13 @@ typedef enum { CONTRACT_DATA_ENABLED = true, CONTRACT_DATA_DISABLED = false } co
 
 // common defines and types for sign tx and sign tx hash
 
-#define MAX_AMOUNT_LEN              32
-#define MAX_BUFFER_LEN              500
-#define MAX_ESDT_TRANSFER_DATA_SIZE 100
-#define MAX_DATA_SIZE               400  // 400 in base64 = 300 in ASCII
+#define MAX_AMOUNT_LEN 32
+#define MAX_BUFFER_LEN 500
+#define MAX_DATA_SIZE  400  // 400 in base64 = 300 in ASCII
 #ifdef HAVE_BAGL
 #define MAX_DISPLAY_DATA_SIZE 64UL  // must be multiple of 4
 #else
 // must be multiple of 4
-// must be <= MAX_VALUE_LEN
 #define MAX_DISPLAY_DATA_SIZE 128UL
 #endif
 #define DATA_SIZE_LEN                      17
@@ -90,15 +93,14 @@ typedef enum { CONTRACT_DATA_ENABLED = true, CONTRACT_DATA_DISABLED = false } co
 #define SHA3_KECCAK_BITS                   256
 #define PUBLIC_KEY_LEN                     32
 #define BASE_10                            10
-#define TX_SIGN_FLOW_SIZE                  10
-#define ESDT_TRANSFER_FLOW_SIZE            10
+#define TX_SIGN_FLOW_SIZE                  11
+#define ESDT_TRANSFER_FLOW_SIZE            11
 #define BASE_64_INVALID_CHAR               '?'
 #define SC_ARGS_SEPARATOR                  '@'
 #define MAX_ESDT_VALUE_HEX_COUNT           32
 #define INVALID_INDEX                      -1
 #define ESDT_CODE_VALUE_TOO_HIGH           '1'
 #define ESDT_CODE_VALUE_OK                 '2'
-#define ESDT_VALUE_MAX_LENGTH              40
 #define ESDT_TRANSFER_PREFIX               "ESDTTransfer@"
 #define ESDT_VALUE_N_A                     "N/A"
 #define ESDT_VALUE_TOO_LONG                "<value too big to display>"
@@ -84,24 +84,23 @@ UX_FLOW(ux_display_public_flow,
 
 #endif
 
-void handle_get_address(uint8_t p1,
-                        uint8_t p2,
-                        uint8_t *data_buffer,
-                        uint16_t data_length,
-                        volatile unsigned int *flags,
-                        volatile unsigned int *tx) {
+uint16_t handle_get_address(uint8_t p1,
+                            uint8_t p2,
+                            uint8_t *data_buffer,
+                            uint16_t data_length,
+                            volatile unsigned int *flags,
+                            volatile unsigned int *tx) {
     uint8_t public_key[PUBLIC_KEY_LEN];
     uint32_t account, index;
 
     if (data_length != sizeof(uint32_t) * 2) {
-        THROW(ERR_INVALID_ARGUMENTS);
-        return;
+        return ERR_INVALID_ARGUMENTS;
     }
 
     account = read_uint32_be(data_buffer);
     index = read_uint32_be(data_buffer + sizeof(uint32_t));
     if (!get_public_key(account, index, public_key)) {
-        THROW(ERR_INVALID_ARGUMENTS);
+        return ERR_INVALID_ARGUMENTS;
     }
 
     switch (p2) {
@@ -112,13 +111,12 @@ void handle_get_address(uint8_t p1,
             get_address_hex_from_binary(public_key, address);
             break;
         default:
-            THROW(ERR_INVALID_ARGUMENTS);
-            return;
+            return ERR_INVALID_ARGUMENTS;
     }
 
     if (p1 == P1_NON_CONFIRM) {
         *tx = set_result_get_address();
-        THROW(MSG_OK);
+        return MSG_OK;
     } else {
 #if defined(TARGET_STAX)
         ui_get_public_key_nbgl();
@@ -126,5 +124,66 @@ void handle_get_address(uint8_t p1,
         ux_flow_init(0, ux_display_public_flow, NULL);
 #endif
         *flags |= IO_ASYNCH_REPLY;
+        return MSG_OK;
     }
 }
+
+// returns <count> consecutive addresses of an account in a single response,
+// packed back to back either as raw public keys or as bech32 strings
+uint16_t handle_get_addresses(uint8_t p2,
+                              uint8_t *data_buffer,
+                              uint16_t data_length,
+                              volatile unsigned int *tx) {
+    /*
+       data buffer structure should be:
+       <account> + <start index> + <count>
+           ^             ^            ^
+        4 bytes       4 bytes      1 byte
+    */
+    uint8_t public_key[PUBLIC_KEY_LEN];
+    uint32_t account, start_index;
+    uint8_t count, entry_size;
+    uint16_t offset = 0;
+
+    if (data_length != sizeof(uint32_t) * 2 + 1) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+
+    account = read_uint32_be(data_buffer);
+    start_index = read_uint32_be(data_buffer + sizeof(uint32_t));
+    count = data_buffer[sizeof(uint32_t) * 2];
+
+    switch (p2) {
+        case P2_BATCH_RAW:
+            entry_size = PUBLIC_KEY_LEN;
+            break;
+        case P2_BATCH_BECH32:
+            entry_size = BECH32_ADDRESS_LEN;
+            break;
+        default:
+            return ERR_INVALID_ARGUMENTS;
+    }
+
+    if (count == 0 || count > MAX_ADDRESS_BATCH_COUNT(entry_size)) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+    if (start_index > UINT32_MAX - (count - 1)) {
+        return ERR_INDEX_OUT_OF_BOUNDS;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!get_public_key(account, start_index + i, public_key)) {
+            return ERR_INVALID_ARGUMENTS;
+        }
+        if (p2 == P2_BATCH_RAW) {
+            memmove(G_io_apdu_buffer + offset, public_key, PUBLIC_KEY_LEN);
+        } else {
+            get_address_bech32_from_binary(public_key, address);
+            memmove(G_io_apdu_buffer + offset, address, BECH32_ADDRESS_LEN);
+        }
+        offset += entry_size;
+    }
+
+    *tx = offset;
+    return MSG_OK;
+}
@@ -6,11 +6,23 @@
 #define P2_DISPLAY_BECH32 0x00
 #define P2_DISPLAY_HEX    0x01
 
-void handle_get_address(uint8_t p1,
-                        uint8_t p2,
-                        uint8_t *data_buffer,
-                        uint16_t data_length,
-                        volatile unsigned int *flags,
-                        volatile unsigned int *tx);
+#define P2_BATCH_RAW    0x00
+#define P2_BATCH_BECH32 0x01
+
+// largest count of a batch whose entries take entry_size bytes: the whole response, status word
+// included, has to fit in the IO buffer
+#define MAX_ADDRESS_BATCH_COUNT(entry_size) ((sizeof(G_io_apdu_buffer) - 2) / (entry_size))
+
+uint16_t handle_get_address(uint8_t p1,
+                            uint8_t p2,
+                            uint8_t *data_buffer,
+                            uint16_t data_length,
+                            volatile unsigned int *flags,
+                            volatile unsigned int *tx);
+
+uint16_t handle_get_addresses(uint8_t p2,
+                              uint8_t *data_buffer,
+                              uint16_t data_length,
+                              volatile unsigned int *tx);
 
 #endif
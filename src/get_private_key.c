@@ -3,6 +3,7 @@
 
 #include "constants.h"
 #include "get_private_key.h"
+#include "perf_stats.h"
 
 static const uint32_t HARDENED_OFFSET = 0x80000000;
 static const uint32_t derive_path[BIP32_PATH] = {44 | HARDENED_OFFSET,
@@ -11,19 +12,44 @@ static const uint32_t derive_path[BIP32_PATH] = {44 | HARDENED_OFFSET,
                                                  0 | HARDENED_OFFSET,
                                                  0 | HARDENED_OFFSET};
 
-bool get_private_key(uint32_t account_index,
-                     uint32_t address_index,
-                     cx_ecfp_private_key_t *private_key) {
+// single slot cache holding the last derived key, so that consecutive
+// signatures with the same account skip the BIP32 derivation
+typedef struct {
+    bool valid;
+    uint32_t account_index;
+    uint32_t address_index;
+    uint16_t idle_ticks;
+    uint8_t private_key_data[32];
+} private_key_cache_t;
+
+static private_key_cache_t private_key_cache;
+
+void clear_private_key_cache(void) {
+    explicit_bzero(&private_key_cache, sizeof(private_key_cache));
+}
+
+void private_key_cache_tick(void) {
+    if (!private_key_cache.valid) {
+        return;
+    }
+    private_key_cache.idle_ticks++;
+    if (private_key_cache.idle_ticks >= KEY_CACHE_TIMEOUT_TICKS) {
+        clear_private_key_cache();
+    }
+}
+
+static bool derive_private_key_data(uint32_t account_index, uint32_t address_index) {
     uint8_t private_key_data[64];
     uint32_t bip32_path[BIP32_PATH];
-    bool success = true;
     int ret_code = 0;
 
+    clear_private_key_cache();
     memmove(bip32_path, derive_path, sizeof(derive_path));
 
     bip32_path[2] = account_index | HARDENED_OFFSET;
     bip32_path[4] = address_index | HARDENED_OFFSET;
 
+    PERF_STATS_START(PERF_SECTION_DERIVATION);
     ret_code = os_derive_bip32_with_seed_no_throw(HDW_ED25519_SLIP10,
                                                   CX_CURVE_Ed25519,
                                                   bip32_path,
@@ -32,16 +58,41 @@ bool get_private_key(uint32_t account_index,
                                                   NULL,
                                                   NULL,
                                                   0);
-    if (ret_code != 0) {
-        success = false;
-    } else {
-        ret_code =
-            cx_ecfp_init_private_key_no_throw(CX_CURVE_Ed25519, private_key_data, 32, private_key);
-        if (ret_code != 0) {
-            success = false;
-        }
+    PERF_STATS_STOP(PERF_SECTION_DERIVATION);
+    if (ret_code == 0) {
+        memmove(private_key_cache.private_key_data,
+                private_key_data,
+                sizeof(private_key_cache.private_key_data));
+        private_key_cache.account_index = account_index;
+        private_key_cache.address_index = address_index;
+        private_key_cache.valid = true;
     }
     explicit_bzero(private_key_data, sizeof(private_key_data));
 
-    return success;
+    return ret_code == 0;
+}
+
+bool get_private_key(uint32_t account_index,
+                     uint32_t address_index,
+                     cx_ecfp_private_key_t *private_key) {
+    int ret_code = 0;
+
+    if (!private_key_cache.valid || private_key_cache.account_index != account_index ||
+        private_key_cache.address_index != address_index) {
+        if (!derive_private_key_data(account_index, address_index)) {
+            return false;
+        }
+    }
+    private_key_cache.idle_ticks = 0;
+
+    ret_code = cx_ecfp_init_private_key_no_throw(CX_CURVE_Ed25519,
+                                                 private_key_cache.private_key_data,
+                                                 sizeof(private_key_cache.private_key_data),
+                                                 private_key);
+    if (ret_code != 0) {
+        clear_private_key_cache();
+        return false;
+    }
+
+    return true;
 }
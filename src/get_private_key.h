@@ -6,6 +6,18 @@
 #include "cx.h"
 #include "os.h"
 
+// number of derived keys kept by the cache
+#define KEY_CACHE_SLOTS 1
+
+// idle time after which the cached private key is wiped, counted in ticker
+// events (one every 100ms)
+#ifndef KEY_CACHE_TIMEOUT_TICKS
+#define KEY_CACHE_TIMEOUT_TICKS 300
+#endif
+
 bool get_private_key(uint32_t account_index,
                      uint32_t address_index,
                      cx_ecfp_private_key_t *private_key);
+
+void clear_private_key_cache(void);
+void private_key_cache_tick(void);
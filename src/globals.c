@@ -1,5 +1,6 @@
 #include "globals.h"
 #include "os.h"
+#include "signing_policy.h"
 #include "ux.h"
 
 ux_state_t G_ux;
@@ -9,6 +10,7 @@ bolos_ux_params_t G_ux_params;
 unsigned int ux_step;
 unsigned int ux_step_count;
 const internal_storage_t N_storage_real;
+const signing_policy_t N_policy_real;
 
 // selected account global variables
 uint32_t bip32_account;
@@ -13,6 +13,7 @@
 #define P1_MORE        0x80
 
 #define DEFAULT_CONTRACT_DATA CONTRACT_DATA_ENABLED
+#define DEFAULT_HASH_SIGNING  HASH_SIGNING_DISABLED
 
 extern ux_state_t ux;
 // display stepped screens
@@ -25,6 +26,7 @@ extern uint32_t bip32_address_index;
 
 typedef struct internal_storage_t {
     unsigned char setting_contract_data;
+    unsigned char setting_hash_signing;
     uint8_t initialized;
 } internal_storage_t;
 
@@ -33,7 +35,13 @@ extern const internal_storage_t N_storage_real;
 
 // common types for sign message and sign tx hash
 
-typedef enum { APP_STATE_IDLE, APP_STATE_SIGNING_MESSAGE, APP_STATE_SIGNING_TX } app_state_t;
+typedef enum {
+    APP_STATE_IDLE,
+    APP_STATE_SIGNING_MESSAGE,
+    APP_STATE_SIGNING_TX,
+    APP_STATE_SIGNING_BATCH,
+    APP_STATE_SIGNING_QUEUE
+} app_state_t;
 
 extern cx_sha3_t sha3_context;
 extern app_state_t app_state;
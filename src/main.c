@@ -17,13 +17,18 @@
  ********************************************************************************/
 
 #include "get_address.h"
+#include "get_private_key.h"
 #include "globals.h"
 #include "menu.h"
+#include "perf_stats.h"
 #include "provide_ESDT_info.h"
 #include "set_address.h"
 #include "sign_msg.h"
 #include "sign_msg_auth_token.h"
+#include "sign_tx_batch.h"
 #include "sign_tx_hash.h"
+#include "sign_tx_queue.h"
+#include "signing_policy.h"
 #include "utils.h"
 
 #define CLA                       0xED
@@ -36,6 +41,25 @@
 #define INS_SIGN_TX_HASH          0x07
 #define INS_PROVIDE_ESDT_INFO     0x08
 #define INS_GET_ADDR_AUTH_TOKEN   0x09
+#define INS_SIGN_TX_HASH_ONLY     0x0A
+#define INS_GET_ADDR_BATCH        0x0B
+#define INS_GET_PERF_STATS        0x0C
+#define INS_GET_CAPABILITIES      0x0D
+#define INS_SIGN_TX_BATCH         0x0E
+#define INS_SIGN_TX_QUEUE         0x0F
+#define INS_SET_POLICY            0x10
+#define INS_GET_SPENDING_LIMITS   0x11
+
+// INS_GET_CAPABILITIES response version and feature bits
+#define CAPABILITIES_VERSION     1
+#define CAPABILITY_ADDRESS_BATCH 0x00000001  // INS_GET_ADDR_BATCH
+#define CAPABILITY_KEY_CACHE     0x00000002  // derived keys are cached between signatures
+#define CAPABILITY_HASH_SIGNING  0x00000004  // INS_SIGN_TX_HASH_ONLY, enabled in the settings
+#define CAPABILITY_RETURN_HASH   0x00000008  // P2_RETURN_HASH of INS_SIGN_TX_HASH
+#define CAPABILITY_PERF_STATS    0x00000010  // INS_GET_PERF_STATS
+#define CAPABILITY_TX_BATCH      0x00000020  // INS_SIGN_TX_BATCH
+#define CAPABILITY_TX_QUEUE      0x00000040  // INS_SIGN_TX_QUEUE
+#define CAPABILITY_POLICY        0x00000080  // a signing policy set with INS_SET_POLICY is enabled
 
 #define OFFSET_CLA   0
 #define OFFSET_INS   1
@@ -51,16 +75,71 @@ esdt_info_t esdt_info;
 void io_seproxyhal_display(const bagl_element_t *element);
 #endif
 
-void handle_apdu(volatile unsigned int *flags, volatile unsigned int *tx);
+void handle_apdu(volatile unsigned int *flags, volatile unsigned int *tx, unsigned int rx);
 void elrond_main(void);
 unsigned char io_event(unsigned char channel);
 unsigned short io_exchange_al(unsigned char channel, unsigned short tx_len);
 void app_exit(void);
 void nv_app_state_init();
 
-void handle_apdu(volatile unsigned int *flags, volatile unsigned int *tx) {
-    unsigned short sw = 0;
-    uint16_t ret;
+// status_word maps the value returned by a handler, or the exception it raised, to the status
+// word sent back: SDK errors are reported as 0x68XX
+static unsigned short status_word(unsigned short e) {
+    switch (e & 0xF000) {
+        case 0x6000:
+        case MSG_OK:
+            return e;
+        default:
+            // Internal error
+            return 0x6800 | (e & 0x7FF);
+    }
+}
+
+// handle_get_capabilities lets hosts pick the fastest protocol the app supports. Fields are only
+// ever appended, hosts have to ignore the trailing bytes they do not know
+static uint16_t handle_get_capabilities(volatile unsigned int *tx) {
+    /*
+       response structure:
+       <version> + <capabilities> + <max raw batch> + <max bech32 batch> + <key cache slots> +
+         1 byte       4 bytes           1 byte             1 byte               1 byte
+       <max tx batch> + <max tx queue>
+          2 bytes          1 byte
+    */
+    uint32_t capabilities = CAPABILITY_ADDRESS_BATCH | CAPABILITY_KEY_CACHE |
+                            CAPABILITY_RETURN_HASH | CAPABILITY_TX_BATCH;
+#if !defined(TARGET_NANOS)
+    capabilities |= CAPABILITY_TX_QUEUE;
+#endif
+    if (N_storage.setting_hash_signing == HASH_SIGNING_ENABLED) {
+        capabilities |= CAPABILITY_HASH_SIGNING;
+    }
+    if (policy_enabled()) {
+        capabilities |= CAPABILITY_POLICY;
+    }
+#ifdef HAVE_PERF_STATS
+    capabilities |= CAPABILITY_PERF_STATS;
+#endif
+
+    G_io_apdu_buffer[0] = CAPABILITIES_VERSION;
+    G_io_apdu_buffer[1] = capabilities >> 24;
+    G_io_apdu_buffer[2] = capabilities >> 16;
+    G_io_apdu_buffer[3] = capabilities >> 8;
+    G_io_apdu_buffer[4] = capabilities;
+    G_io_apdu_buffer[5] = MAX_ADDRESS_BATCH_COUNT(PUBLIC_KEY_LEN);
+    G_io_apdu_buffer[6] = MAX_ADDRESS_BATCH_COUNT(BECH32_ADDRESS_LEN);
+    G_io_apdu_buffer[7] = KEY_CACHE_SLOTS;
+    G_io_apdu_buffer[8] = MAX_BATCH_TX_COUNT >> 8;
+    G_io_apdu_buffer[9] = MAX_BATCH_TX_COUNT & 0xff;
+    G_io_apdu_buffer[10] = MAX_TX_QUEUE_COUNT;
+
+    *tx = 11;
+    return MSG_OK;
+}
+
+void handle_apdu(volatile unsigned int *flags, volatile unsigned int *tx, unsigned int rx) {
+    volatile unsigned short sw = MSG_OK;
+
+    PERF_STATS_APDU_BEGIN(G_io_apdu_buffer[OFFSET_INS], rx);
 
     BEGIN_TRY {
         TRY {
@@ -68,11 +147,17 @@ void handle_apdu(volatile unsigned int *flags, volatile unsigned int *tx) {
                 THROW(ERR_WRONG_CLA);
             }
 
+            // handlers return the status word, exceptions are left for real faults
+
+            if (G_io_apdu_buffer[OFFSET_INS] != INS_SIGN_TX_BATCH) {
+                // a batch only lives through consecutive INS_SIGN_TX_BATCH
+                init_batch_context();
+            }
+
             switch (G_io_apdu_buffer[OFFSET_INS]) {
                 case INS_GET_APP_VERSION:
                     *tx = strlen(APPVERSION);
                     memcpy(G_io_apdu_buffer, APPVERSION, *tx);
-                    THROW(MSG_OK);
                     break;
 
                 case INS_GET_APP_CONFIGURATION:
@@ -97,88 +182,140 @@ void handle_apdu(volatile unsigned int *flags, volatile unsigned int *tx) {
                     G_io_apdu_buffer[13] = bip32_address_index;
 
                     *tx = 14;
-                    THROW(MSG_OK);
+                    break;
+
+                case INS_GET_CAPABILITIES:
+                    sw = handle_get_capabilities(tx);
                     break;
 
                 case INS_GET_ADDR:
-                    handle_get_address(G_io_apdu_buffer[OFFSET_P1],
-                                       G_io_apdu_buffer[OFFSET_P2],
-                                       G_io_apdu_buffer + OFFSET_CDATA,
-                                       G_io_apdu_buffer[OFFSET_LC],
-                                       flags,
-                                       tx);
+                    sw = handle_get_address(G_io_apdu_buffer[OFFSET_P1],
+                                            G_io_apdu_buffer[OFFSET_P2],
+                                            G_io_apdu_buffer + OFFSET_CDATA,
+                                            G_io_apdu_buffer[OFFSET_LC],
+                                            flags,
+                                            tx);
+                    break;
+
+                case INS_GET_ADDR_BATCH:
+                    sw = handle_get_addresses(G_io_apdu_buffer[OFFSET_P2],
+                                              G_io_apdu_buffer + OFFSET_CDATA,
+                                              G_io_apdu_buffer[OFFSET_LC],
+                                              tx);
                     break;
 
                 case INS_GET_ADDR_AUTH_TOKEN:
-                    handle_auth_token(G_io_apdu_buffer[OFFSET_P1],
-                                      G_io_apdu_buffer + OFFSET_CDATA,
-                                      G_io_apdu_buffer[OFFSET_LC],
-                                      flags);
+                    sw = handle_auth_token(G_io_apdu_buffer[OFFSET_P1],
+                                           G_io_apdu_buffer + OFFSET_CDATA,
+                                           G_io_apdu_buffer[OFFSET_LC],
+                                           flags);
                     break;
 
                 case INS_SET_ADDR:
-                    ret = handle_set_address(G_io_apdu_buffer + OFFSET_CDATA,
-                                             G_io_apdu_buffer[OFFSET_LC]);
-                    THROW(ret);
+                    sw = handle_set_address(G_io_apdu_buffer + OFFSET_CDATA,
+                                            G_io_apdu_buffer[OFFSET_LC]);
                     break;
 
                 case INS_SIGN_TX:
                     // sign tx is deprecated in this version. Hash signing should be used
-                    THROW(ERR_SIGN_TX_DEPRECATED);
+                    sw = ERR_SIGN_TX_DEPRECATED;
                     break;
 
                 case INS_SIGN_MSG:
-                    handle_sign_msg(G_io_apdu_buffer[OFFSET_P1],
-                                    G_io_apdu_buffer + OFFSET_CDATA,
-                                    G_io_apdu_buffer[OFFSET_LC],
-                                    flags);
+                    sw = handle_sign_msg(G_io_apdu_buffer[OFFSET_P1],
+                                         G_io_apdu_buffer + OFFSET_CDATA,
+                                         G_io_apdu_buffer[OFFSET_LC],
+                                         flags);
                     break;
 
                 case INS_SIGN_TX_HASH:
-                    handle_sign_tx_hash(G_io_apdu_buffer[OFFSET_P1],
-                                        G_io_apdu_buffer + OFFSET_CDATA,
-                                        G_io_apdu_buffer[OFFSET_LC],
-                                        flags);
+                    sw = handle_sign_tx_hash(G_io_apdu_buffer[OFFSET_P1],
+                                             G_io_apdu_buffer[OFFSET_P2],
+                                             G_io_apdu_buffer + OFFSET_CDATA,
+                                             G_io_apdu_buffer[OFFSET_LC],
+                                             flags,
+                                             tx);
+                    break;
+
+                case INS_SIGN_TX_HASH_ONLY:
+                    sw = handle_sign_tx_hash_only(G_io_apdu_buffer[OFFSET_P1],
+                                                  G_io_apdu_buffer + OFFSET_CDATA,
+                                                  G_io_apdu_buffer[OFFSET_LC],
+                                                  flags);
+                    break;
+
+                case INS_SIGN_TX_BATCH:
+                    sw = handle_sign_tx_batch(G_io_apdu_buffer[OFFSET_P1],
+                                              G_io_apdu_buffer + OFFSET_CDATA,
+                                              G_io_apdu_buffer[OFFSET_LC],
+                                              flags,
+                                              tx);
+                    break;
+
+#if !defined(TARGET_NANOS)
+                case INS_SIGN_TX_QUEUE:
+                    sw = handle_sign_tx_queue(G_io_apdu_buffer[OFFSET_P1],
+                                              G_io_apdu_buffer + OFFSET_CDATA,
+                                              G_io_apdu_buffer[OFFSET_LC],
+                                              flags);
+                    break;
+#endif
+
+                case INS_SET_POLICY:
+                    sw = handle_set_policy(G_io_apdu_buffer[OFFSET_P1],
+                                           G_io_apdu_buffer + OFFSET_CDATA,
+                                           G_io_apdu_buffer[OFFSET_LC],
+                                           flags);
+                    break;
+
+                case INS_GET_SPENDING_LIMITS:
+                    sw = handle_get_spending_limits(tx);
                     break;
 
                 case INS_PROVIDE_ESDT_INFO:
-                    ret = handle_provide_ESDT_info(G_io_apdu_buffer + OFFSET_CDATA,
-                                                   G_io_apdu_buffer[OFFSET_LC],
-                                                   &esdt_info);
-                    THROW(ret);
+                    sw = handle_provide_ESDT_info(G_io_apdu_buffer + OFFSET_CDATA,
+                                                  G_io_apdu_buffer[OFFSET_LC],
+                                                  &esdt_info);
                     break;
 
+#ifdef HAVE_PERF_STATS
+                case INS_GET_PERF_STATS:
+                    sw = handle_get_perf_stats(G_io_apdu_buffer[OFFSET_P1],
+                                               G_io_apdu_buffer[OFFSET_P2],
+                                               tx);
+                    break;
+#endif
+
                 default:
-                    THROW(ERR_UNKNOWN_INSTRUCTION);
+                    sw = ERR_UNKNOWN_INSTRUCTION;
                     break;
             }
         }
         CATCH(EXCEPTION_IO_RESET) {
+            clear_private_key_cache();
+            init_batch_context();
             THROW(EXCEPTION_IO_RESET);
         }
         CATCH_OTHER(e) {
-            switch (e & 0xF000) {
-                case 0x6000:
-                    sw = e;
-                    break;
-                case MSG_OK:
-                    // All is well
-                    sw = e;
-                    break;
-                default:
-                    // Internal error
-                    sw = 0x6800 | (e & 0x7FF);
-                    break;
-            }
-            // Unexpected exception => report
-            G_io_apdu_buffer[*tx] = sw >> 8;
-            G_io_apdu_buffer[*tx + 1] = sw;
-            *tx += 2;
+            sw = e;
         }
         FINALLY {
+            PERF_STATS_APDU_END();
         }
     }
     END_TRY;
+
+    sw = status_word(sw);
+    if (sw != MSG_OK) {
+        clear_private_key_cache();
+        *flags &= ~IO_ASYNCH_REPLY;
+    } else if (*flags & IO_ASYNCH_REPLY) {
+        // the response is sent once the user has gone through the review
+        return;
+    }
+    G_io_apdu_buffer[*tx] = sw >> 8;
+    G_io_apdu_buffer[*tx + 1] = sw;
+    *tx += 2;
 }
 
 void elrond_main(void) {
@@ -188,6 +325,10 @@ void elrond_main(void) {
 
     init_msg_context();
     init_tx_context();
+    init_batch_context();
+#if !defined(TARGET_NANOS)
+    init_queue_context();
+#endif
     esdt_info.valid = false;
 
     // DESIGN NOTE: the bootloader ignores the way APDU are fetched. The only
@@ -213,25 +354,13 @@ void elrond_main(void) {
                     THROW(0x6982);
                 }
 
-                handle_apdu(&flags, &tx);
+                handle_apdu(&flags, &tx, rx);
             }
             CATCH(EXCEPTION_IO_RESET) {
                 THROW(EXCEPTION_IO_RESET);
             }
             CATCH_OTHER(e) {
-                switch (e & 0xF000) {
-                    case 0x6000:
-                        sw = e;
-                        break;
-                    case MSG_OK:
-                        // All is well
-                        sw = e;
-                        break;
-                    default:
-                        // Internal error
-                        sw = 0x6800 | (e & 0x7FF);
-                        break;
-                }
+                sw = status_word(e);
                 if (e != MSG_OK) {
                     flags &= ~IO_ASYNCH_REPLY;
                 }
@@ -293,6 +422,8 @@ unsigned char io_event(unsigned char channel) {
             break;
 
         case SEPROXYHAL_TAG_TICKER_EVENT:
+            private_key_cache_tick();
+            batch_context_tick();
             UX_TICKER_EVENT(G_io_seproxyhal_spi_buffer, {
 #if defined(TARGET_NANOS)
                 if (UX_ALLOWED) {
@@ -346,6 +477,7 @@ unsigned short io_exchange_al(unsigned char channel, unsigned short tx_len) {
 }
 
 void app_exit(void) {
+    clear_private_key_cache();
     BEGIN_TRY_L(exit) {
         TRY_L(exit) {
             os_sched_exit(-1);
@@ -360,14 +492,17 @@ void nv_app_state_init() {
     if (N_storage.initialized != 0x01) {
         internal_storage_t storage;
         storage.setting_contract_data = DEFAULT_CONTRACT_DATA;
+        storage.setting_hash_signing = DEFAULT_HASH_SIGNING;
         storage.initialized = 0x01;
         nvm_write((internal_storage_t *) &N_storage, (void *) &storage, sizeof(internal_storage_t));
     }
 }
 
 __attribute__((section(".boot"))) int main(void) {
+#ifndef SIMULATION
     // exit critical section
     __asm volatile("cpsie i");
+#endif
 
     // ensure exception will work as planned
     os_boot();
@@ -2,6 +2,7 @@
 #include "os.h"
 #include "view_app_version.h"
 #include "utils.h"
+#include "get_private_key.h"
 
 #ifdef HAVE_NBGL
 #include "nbgl_use_case.h"
@@ -13,15 +14,18 @@ static const char* const info_types[] = {"Version", APPNAME};
 static const char* const info_contents[] = {APPVERSION, "(c) 2023 Ledger"};
 
 static void quit_app_callback(void) {
+    clear_private_key_cache();
     os_sched_exit(-1);
 }
 
-#define NB_SETTINGS_SWITCHES 1
+#define NB_SETTINGS_SWITCHES 2
 static nbgl_layoutSwitch_t G_switches[NB_SETTINGS_SWITCHES];
 #define CONTRACT_DATA_IDX 0
+#define HASH_SIGNING_IDX  1
 
 enum {
     SWITCH_CONTRACT_DATA_SET_TOKEN = FIRST_USER_TOKEN,
+    SWITCH_HASH_SIGNING_SET_TOKEN,
 };
 
 #define SETTINGS_PAGE_NUMBER 2
@@ -40,6 +44,15 @@ static void settings_controls_callback(int token, uint8_t index, int action) {
             }
             nvm_write((void*) &N_storage.setting_contract_data, &new_setting, 1);
             break;
+        case SWITCH_HASH_SIGNING_SET_TOKEN:
+            G_switches[HASH_SIGNING_IDX].initState = !(G_switches[HASH_SIGNING_IDX].initState);
+            if (G_switches[HASH_SIGNING_IDX].initState == OFF_STATE) {
+                new_setting = HASH_SIGNING_DISABLED;
+            } else {
+                new_setting = HASH_SIGNING_ENABLED;
+            }
+            nvm_write((void*) &N_storage.setting_hash_signing, &new_setting, 1);
+            break;
         default:
             PRINTF("Should not happen !\n");
             break;
@@ -64,7 +77,7 @@ static void initialize_settings_contents(void) {
 
     settings_contents.callbackCallNeeded = false;
     settings_contents.contentsList = &settings_page_content;
-    settings_contents.nbContents = NB_SETTINGS_SWITCHES;
+    settings_contents.nbContents = 1;
 }
 
 static void ui_menu_main(void) {
@@ -77,6 +90,15 @@ static void ui_menu_main(void) {
     } else {
         G_switches[CONTRACT_DATA_IDX].initState = ON_STATE;
     }
+    G_switches[HASH_SIGNING_IDX].text = "Hash signing";
+    G_switches[HASH_SIGNING_IDX].subText = "Enable blind signing of\ntransaction hashes";
+    G_switches[HASH_SIGNING_IDX].token = SWITCH_HASH_SIGNING_SET_TOKEN;
+    G_switches[HASH_SIGNING_IDX].tuneId = TUNE_TAP_CASUAL;
+    if (N_storage.setting_hash_signing == HASH_SIGNING_ENABLED) {
+        G_switches[HASH_SIGNING_IDX].initState = ON_STATE;
+    } else {
+        G_switches[HASH_SIGNING_IDX].initState = OFF_STATE;
+    }
 
     initialize_settings_contents();
 
@@ -92,9 +114,16 @@ static void ui_menu_main(void) {
 
 #else
 
+static void quit_app(void) {
+    clear_private_key_cache();
+    os_sched_exit(-1);
+}
+
 const char *const setting_contract_data_getter_values[] = {"No", "Yes", "Back"};
+const char *const setting_hash_signing_getter_values[] = {"No", "Yes", "Back"};
 const char *const settings_submenu_getter_values[] = {
     "Contract data",
+    "Hash signing",
     "Back",
 };
 const char *const info_submenu_getter_values[] = {
@@ -105,6 +134,9 @@ const char *const info_submenu_getter_values[] = {
 static void setting_contract_data_change(unsigned int contract_data);
 static const char *setting_contract_data_getter(unsigned int idx);
 static void setting_contract_data_selector(unsigned int idx);
+static void setting_hash_signing_change(unsigned int hash_signing);
+static const char *setting_hash_signing_getter(unsigned int idx);
+static void setting_hash_signing_selector(unsigned int idx);
 static const char *settings_submenu_getter(unsigned int idx);
 static void settings_submenu_selector(unsigned int idx);
 static const char *info_submenu_getter(unsigned int idx);
@@ -133,7 +165,7 @@ UX_STEP_VALID(ux_idle_flow_3_step,
               });
 UX_STEP_VALID(ux_idle_flow_4_step,
               pb,
-              os_sched_exit(-1),
+              quit_app(),
               {
                   &C_icon_dashboard_x,
                   "Quit",
@@ -171,6 +203,32 @@ static void setting_contract_data_selector(unsigned int idx) {
     }
 }
 
+// Hash signing submenu:
+static void setting_hash_signing_change(unsigned int hash_signing) {
+    nvm_write((void *) &N_storage.setting_hash_signing, &hash_signing, 1);
+    ui_idle();
+}
+
+static const char *setting_hash_signing_getter(unsigned int idx) {
+    if (idx < ARRAYLEN(setting_hash_signing_getter_values))
+        return setting_hash_signing_getter_values[idx];
+    return NULL;
+}
+
+static void setting_hash_signing_selector(unsigned int idx) {
+    switch (idx) {
+        case HASH_SIGNING_DISABLED:
+            setting_hash_signing_change(HASH_SIGNING_DISABLED);
+            break;
+        case HASH_SIGNING_ENABLED:
+            setting_hash_signing_change(HASH_SIGNING_ENABLED);
+            break;
+        default:
+            ux_menulist_init(0, settings_submenu_getter, settings_submenu_selector);
+            break;
+    }
+}
+
 // Settings menu:
 static const char *settings_submenu_getter(unsigned int idx) {
     if (idx < ARRAYLEN(settings_submenu_getter_values)) return settings_submenu_getter_values[idx];
@@ -185,6 +243,12 @@ static void settings_submenu_selector(unsigned int idx) {
                                     setting_contract_data_selector,
                                     N_storage.setting_contract_data);
             break;
+        case 1:
+            ux_menulist_init_select(0,
+                                    setting_hash_signing_getter,
+                                    setting_hash_signing_selector,
+                                    N_storage.setting_hash_signing);
+            break;
         default:
             ui_idle();
             break;
@@ -7,103 +7,128 @@
 #include "parse_tx.h"
 #include "provide_ESDT_info.h"
 #include "sign_tx_hash.h"
+#include "swar.h"
 
 #ifndef FUZZING
 #include "globals.h"
 #endif
 
-static void extract_esdt_value(const char *encoded_data_field, const uint8_t encoded_data_length);
+static void extract_esdt_value(const char *decoded, uint32_t decoded_len);
 static void set_network(const char *chain_id);
 static void set_message_in_amount(const char *message);
 
+// digit p of the amount once left padded with `missing` zeros
+static char padded_digit(const char *digits, size_t missing, size_t p) {
+    return p < missing ? '0' : digits[p - missing];
+}
+
 // make the eGLD/token amount look pretty. Add decimals, decimal point and
-// ticker name
-//  example: amount=500, decimal_places=3 => amount=0.5 eGLD
-bool make_amount_pretty(char *amount, size_t max_size, const char *ticker, int decimals_places) {
-    int len = strlen(amount);
-    if ((size_t) len + PRETTY_SIZE >= max_size) {
+// ticker name, writing the result straight into out
+//  example: amount=500, decimals=3 => out=0.5 eGLD
+static bool format_amount_digits(const char *digits,
+                                 size_t len,
+                                 uint8_t decimals,
+                                 const char *ticker,
+                                 char *out,
+                                 size_t max_size) {
+    if (len + PRETTY_SIZE >= max_size) {
+        return false;
+    }
+    // leading 0s needed to have at least one digit before the decimal point
+    size_t missing = 0;
+    if ((size_t) decimals + 1 > len) {
+        missing = decimals + 1 - len;
+    }
+    size_t integer_len = missing + len - decimals;
+    size_t fraction_len = decimals;
+    while (fraction_len > 0 &&
+           padded_digit(digits, missing, integer_len + fraction_len - 1) == '0') {
+        fraction_len--;
+    }
+
+    size_t ticker_len = strlen(ticker);
+    size_t total_len = integer_len + (fraction_len > 0 ? fraction_len + 1 : 0) + 1 + ticker_len;
+    if (total_len >= max_size) {
         return false;
     }
-    int missing = decimals_places - len + 1;
-    if (missing > 0) {
-        if ((size_t)(missing + len + 1) > max_size) {
-            return false;
+
+    size_t offset = 0;
+    for (size_t p = 0; p < integer_len; p++) {
+        out[offset++] = padded_digit(digits, missing, p);
+    }
+    if (fraction_len > 0) {
+        out[offset++] = '.';
+        for (size_t p = integer_len; p < integer_len + fraction_len; p++) {
+            out[offset++] = padded_digit(digits, missing, p);
         }
-        // missing represents the leading 0s. amount needs to be moved to the right and the missing
-        // 0s prepended
-        memmove(amount + missing, amount, len + 1);
-        // replace remaining leading characters with 0s in the buffer
-        memset(amount, '0', missing);
-    }
-    len = strlen(amount);
-    int dotPos = len - decimals_places;
-    memmove(amount + dotPos + 1, amount + dotPos, decimals_places + 1);
-    amount[dotPos] = '.';
-    while (amount[strlen(amount) - 1] == '0') {
-        amount[strlen(amount) - 1] = '\0';
-    }
-    if (amount[strlen(amount) - 1] == '.') {
-        amount[strlen(amount) - 1] = '\0';
-    }
-    char suffix[MAX_TICKER_LEN + 2] = " \0";  // 2 = leading space + trailing \0
-    memmove(suffix + 1, ticker, strlen(ticker) + 1);
-    memmove(amount + strlen(amount), suffix, strlen(suffix) + 1);
+    }
+    out[offset++] = ' ';
+    memmove(out + offset, ticker, ticker_len);
+    out[offset + ticker_len] = '\0';
 
     return true;
 }
 
-bool is_hex_digit(char c) {
-    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+// formats value / 10^decimals followed by the ticker
+bool format_amount(uint128_t *value,
+                   uint8_t decimals,
+                   const char *ticker,
+                   char *out,
+                   size_t max_size) {
+    char digits[MAX_UINT128_LEN + 1];
+    if (!tostring128(value, BASE_10, digits, sizeof(digits))) {
+        return false;
+    }
+    return format_amount_digits(digits, strlen(digits), decimals, ticker, out, max_size);
 }
 
 bool parse_int(char *str, size_t size, uint64_t *result) {
-    uint64_t min = 0, n = 0;
+    return swar_parse_u64(str, size, result);
+}
 
-    for (size_t i = 0; i < size; i++) {
-        if (!is_digit(str[i])) {
-            return false;
-        }
-        n = n * 10 + str[i] - '0';
-        /* ensure there is no integer overflow */
-        if (n < min) {
-            return false;
-        }
-        min = n;
+bool parse_hex(const char *str, size_t size, uint128_t *result) {
+    uint128_t n = {{0, 0}};
+    uint128_t tmp = {{0, 0}};
+
+    if (!swar_is_hex_digits(str, size)) {
+        return false;
+    }
+    // leading digits one at a time, so that the rest splits in 8 digit words
+    size_t i = 0;
+    for (; i < size % 8; i++) {
+        uint128_t digit = {{0, swar_hex_value(str[i])}};
+        shiftl128(&n, 4, &tmp);
+        add128(&tmp, &digit, &n);
+    }
+    for (; i < size; i += 8) {
+        uint128_t word = {{0, swar_hex8_value(str + i)}};
+        shiftl128(&n, 32, &tmp);
+        add128(&tmp, &word, &n);
     }
     *result = n;
     return true;
 }
 
-bool parse_hex(const char *str, size_t size, uint128_t *result) {
+// value of size validated decimal digits, at most MAX_AMOUNT_LEN of them so that it fits
+static void parse_decimal(const char *str, size_t size, uint128_t *result) {
     uint128_t n = {{0, 0}};
-    uint128_t tmp = {{0, 0}};
+    uint128_t times2;
+    uint128_t times8;
 
     for (size_t i = 0; i < size; i++) {
-        if (!is_hex_digit(str[i])) {
-            return false;
-        }
         uint128_t digit = {{0, str[i] - '0'}};
-        if (str[i] >= 'a') {
-            digit.elements[1] = str[i] - 'a' + 10;
-        } else if (str[i] >= 'A') {
-            digit.elements[1] = str[i] - 'A' + 10;
-        }
-        shiftl128(&n, 4, &tmp);
-        add128(&tmp, &digit, &n);
+        shiftl128(&n, 1, &times2);
+        shiftl128(&n, 3, &times8);
+        add128(&times2, &times8, &n);
+        add128(&n, &digit, &n);
     }
     *result = n;
-    return true;
 }
 
-bool gas_to_fee(uint64_t gas_limit,
-                uint64_t gas_price,
-                uint32_t data_size,
-                char *fee,
-                size_t size) {
-    uint128_t x = {{0, GAS_PER_DATA_BYTE}};
-    uint128_t y = {{0, data_size}};
-    uint128_t z;
-    uint128_t gas_unit_for_move_balance;
+void gas_to_fee(uint64_t gas_limit, uint64_t gas_price, uint32_t data_size, uint128_t *fee) {
+    static reciprocal64_t gas_price_divider;
+    uint128_t x;
+    uint128_t y;
 
     // tx fee formula
     // gas_units_for_move_balance = (min_gas_limit + len(data)*gas_per_data_byte)
@@ -111,227 +136,185 @@ bool gas_to_fee(uint64_t gas_limit,
     // gas_unit_for_move_balance) * gas_price_modifier * gas_price. The difference
     // is that instead of multiplying with gas_price_modifier we divide by
     // 1/gas_price_modifier and the constant is marked as GAS_PRICE_DIVIER
+    // The operands fit in 64 bits, the arithmetic stays modulo 2^128.
 
-    mul128(&x, &y, &z);
-
-    x.elements[1] = MIN_GAS_LIMIT;
-    add128(&x, &z, &gas_unit_for_move_balance);
+    if (gas_price_divider.divisor == 0) {
+        reciprocal64(GAS_PRICE_DIVIDER, &gas_price_divider);
+    }
 
-    x.elements[1] = gas_limit;
-    minus128(&x, &gas_unit_for_move_balance, &y);
+    uint64_t gas_unit_for_move_balance = MIN_GAS_LIMIT + (uint64_t) data_size * GAS_PER_DATA_BYTE;
 
-    x.elements[1] = GAS_PRICE_DIVIDER;
-    divmod128(&y, &x, &z, &y);
+    UPPER(x) = gas_limit < gas_unit_for_move_balance ? UINT64_MAX : 0;
+    LOWER(x) = gas_limit - gas_unit_for_move_balance;
+    divmod128_reciprocal(&x, &gas_price_divider, &y);
 
-    add128(&gas_unit_for_move_balance, &z, &y);
+    LOWER(x) = gas_unit_for_move_balance;
+    UPPER(x) = 0;
+    add128(&x, &y, &y);
 
-    x.elements[1] = gas_price;
-    mul128(&x, &y, &z);
-    /* XXX: there is a one-byte overflow in tostring128(), hence size-1 */
-    if (!tostring128(&z, BASE_10, fee, size - 1)) {
-        return false;
-    }
-    return true;
+    mul64x64_128(gas_price, LOWER(y), fee);
+    UPPER_P(fee) += gas_price * UPPER(y);
 }
 
 bool valid_amount(char *amount, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        if (!is_digit(amount[i])) {
-            return false;
-        }
-    }
-    return true;
+    return swar_is_digits(amount, size);
 }
 
-void compute_data_size(uint32_t decodedDataLen) {
+void compute_data_size(uint32_t decodedDataLen, bool truncated) {
     tx_context.data_size = decodedDataLen;
-    int len = sizeof(tx_context.data);
     // prepare the first display page, which contains the data field size
     char str_size[DATA_SIZE_LEN] = "[Size:       0] ";
     // sprintf equivalent workaround
     for (uint32_t ds = tx_context.data_size, idx = 13; ds > 0; ds /= 10, idx--) {
         str_size[idx] = '0' + ds % 10;
     }
+    // the decoded data field already sits right after the room left for the size
+    memmove(tx_context.data, str_size, DATA_SIZE_LEN - 1);
 
-    int size_len = strlen(str_size);
-    // shift the actual data field to the right in order to make room for
-    // inserting the size in the first page
-    memmove(tx_context.data + size_len, tx_context.data, len - size_len);
-    // insert the data size in front of the actual data field
-    memmove(tx_context.data, str_size, size_len);
-    int data_end = size_len + tx_context.data_size;
-    if (tx_context.data_size > MAX_DISPLAY_DATA_SIZE) {
-        data_end = size_len + MAX_DISPLAY_DATA_SIZE;
+    char *decoded = tx_context.data + DATA_SIZE_LEN - 1;
+    uint32_t display_len = tx_context.data_size;
+    if (truncated) {
+        display_len = MAX_DISPLAY_DECODED_SIZE;
+        // add "..." at the end to show that the data field is actually longer
+        memmove(decoded + display_len - 3, "...", 3);
     }
-    tx_context.data[data_end] = '\0';
+    decoded[display_len] = '\0';
 }
 
 // verify "value" field
-uint16_t verify_value(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, VALUE_FIELD, strlen(VALUE_FIELD)) == 0) {
-        if (tx_hash_context.current_value_len >= sizeof(tx_context.amount)) {
-            return ERR_AMOUNT_TOO_LONG;
-        }
-        if (!valid_amount(tx_hash_context.current_value, strlen(tx_hash_context.current_value))) {
-            return ERR_INVALID_AMOUNT;
-        }
-        memmove(tx_context.amount,
-                tx_hash_context.current_value,
-                tx_hash_context.current_value_len);
-        *valid = true;
+uint16_t verify_value(void) {
+    if (tx_hash_context.current_value_len >= sizeof(tx_context.amount)) {
+        return ERR_AMOUNT_TOO_LONG;
+    }
+    if (!valid_amount(tx_hash_context.current_value, strlen(tx_hash_context.current_value))) {
+        return ERR_INVALID_AMOUNT;
     }
+    memmove(tx_context.amount, tx_hash_context.current_value, tx_hash_context.current_value_len);
+    parse_decimal(tx_hash_context.current_value,
+                  strlen(tx_hash_context.current_value),
+                  &tx_context.value);
     return MSG_OK;
 }
 
 // verify "receiver" field
-uint16_t verify_receiver(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, RECEIVER_FIELD, strlen(RECEIVER_FIELD)) == 0 &&
-        tx_hash_context.current_field_len == strlen(RECEIVER_FIELD)) {
-        if (tx_hash_context.current_value_len >= sizeof(tx_context.receiver)) {
-            return ERR_RECEIVER_TOO_LONG;
-        }
-        memmove(tx_context.receiver,
-                tx_hash_context.current_value,
-                tx_hash_context.current_value_len);
-        *valid = true;
+uint16_t verify_receiver(void) {
+    if (tx_hash_context.current_value_len >= sizeof(tx_context.receiver)) {
+        return ERR_RECEIVER_TOO_LONG;
     }
+    memmove(tx_context.receiver, tx_hash_context.current_value, tx_hash_context.current_value_len);
+    return MSG_OK;
+}
+
+// verify "nonce" field. It is not displayed and a nonce the parser cannot read is left to the
+// network, such a transaction is just never signed under the spending limits
+uint16_t verify_nonce(void) {
+    tx_context.nonce_valid = parse_int(tx_hash_context.current_value,
+                                       strlen(tx_hash_context.current_value),
+                                       &tx_context.nonce);
     return MSG_OK;
 }
 
 // verify "gasPrice" field
-uint16_t verify_gasprice(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, GASPRICE_FIELD, strlen(GASPRICE_FIELD)) == 0) {
-        if (!parse_int(tx_hash_context.current_value,
-                       strlen(tx_hash_context.current_value),
-                       &tx_context.gas_price)) {
-            return ERR_INVALID_FEE;
-        }
-        *valid = true;
+uint16_t verify_gasprice(void) {
+    if (!parse_int(tx_hash_context.current_value,
+                   strlen(tx_hash_context.current_value),
+                   &tx_context.gas_price)) {
+        return ERR_INVALID_FEE;
     }
     return MSG_OK;
 }
 
 // verify "gasLimit" field
-uint16_t verify_gaslimit(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, GASLIMIT_FIELD, strlen(GASLIMIT_FIELD)) == 0) {
-        if (!parse_int(tx_hash_context.current_value,
-                       strlen(tx_hash_context.current_value),
-                       &tx_context.gas_limit)) {
-            return ERR_INVALID_FEE;
-        }
-        *valid = true;
+uint16_t verify_gaslimit(void) {
+    if (!parse_int(tx_hash_context.current_value,
+                   strlen(tx_hash_context.current_value),
+                   &tx_context.gas_limit)) {
+        return ERR_INVALID_FEE;
     }
     return MSG_OK;
 }
 
 // verify "data" field
-uint16_t verify_data(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, DATA_FIELD, strlen(DATA_FIELD)) == 0) {
+uint16_t verify_data(void) {
 #ifndef FUZZING
-        if (N_storage.setting_contract_data == 0) {
-            return ERR_CONTRACT_DATA_DISABLED;
-        }
+    if (N_storage.setting_contract_data == 0) {
+        return ERR_CONTRACT_DATA_DISABLED;
+    }
 #endif
-        tx_hash_context.current_value_len = tx_hash_context.current_value_len / 4 * 4;
-        char encoded[MAX_DISPLAY_DATA_SIZE];
-        uint32_t enc_len = tx_hash_context.current_value_len;
-        if (enc_len > MAX_DISPLAY_DATA_SIZE) {
-            enc_len = MAX_DISPLAY_DATA_SIZE;
-        }
-        memmove(encoded, tx_hash_context.current_value, enc_len);
-        uint32_t ascii_len = tx_hash_context.current_value_len;
-        if (ascii_len > MAX_DISPLAY_DATA_SIZE) {
-            ascii_len = MAX_DISPLAY_DATA_SIZE;
-            // add "..." at the end to show that the data field is actually longer
-            char ellipsis[5] = "Li4u";  // "..." base64 encoded
-            int ellipsisLen = strlen(ellipsis);
-            memmove(encoded + MAX_DISPLAY_DATA_SIZE - ellipsisLen, ellipsis, ellipsisLen);
-        }
-        if (!base64decode(tx_context.data, encoded, ascii_len)) {
-            return ERR_INVALID_MESSAGE;
-        }
-        if (strncmp(tx_context.data, ESDT_TRANSFER_PREFIX, ESDT_TRANSFER_PREFIX_LENGTH) == 0) {
-            extract_esdt_value(tx_hash_context.current_value, tx_hash_context.current_value_len);
-        }
-        compute_data_size(tx_hash_context.data_field_size);
-        *valid = true;
+    // the data field has already been decoded by decode_data_char. Padding
+    // has to close a quad
+    if (tx_hash_context.data_carry_padding != 0) {
+        return ERR_INVALID_MESSAGE;
+    }
+    char *decoded = tx_context.data + DATA_SIZE_LEN - 1;
+    uint32_t decoded_len = tx_hash_context.data_field_size;
+    if (decoded_len > MAX_DATA_DECODED_SIZE) {
+        decoded_len = MAX_DATA_DECODED_SIZE;
+    }
+    if (decoded_len >= ESDT_TRANSFER_PREFIX_LENGTH &&
+        memcmp(decoded, ESDT_TRANSFER_PREFIX, ESDT_TRANSFER_PREFIX_LENGTH) == 0) {
+        extract_esdt_value(decoded, decoded_len);
     }
+    compute_data_size(tx_hash_context.data_field_size,
+                      tx_hash_context.data_field_size > MAX_DISPLAY_DECODED_SIZE);
     return MSG_OK;
 }
 
-static void extract_esdt_value(const char *encoded_data_field, const uint8_t encoded_data_length) {
-    if (encoded_data_length == 0) {
+// extracts <value> from "ESDTTransfer@<identifier>@<value>[@...]" using the
+// separator offsets recorded while decoding
+static void extract_esdt_value(const char *decoded, uint32_t decoded_len) {
+    if (tx_context.data_args_count < 2) {
         return;
     }
-    char data_field[MAX_ESDT_TRANSFER_DATA_SIZE];
-    if (!base64decode(data_field, encoded_data_field, encoded_data_length)) {
-        return;
-    }
-
-    int esdt_value_start_position = INVALID_INDEX;
-    for (size_t idx = ESDT_TRANSFER_PREFIX_LENGTH; idx < strlen(data_field); idx++) {
-        if (data_field[idx] == SC_ARGS_SEPARATOR) {
-            esdt_value_start_position = idx + 1;
-            break;
-        }
+    uint32_t value_start = tx_context.data_args[1] + 1;
+    uint32_t value_end = decoded_len;
+    if (tx_context.data_args_count > 2) {
+        value_end = tx_context.data_args[2];
     }
-    if (esdt_value_start_position == INVALID_INDEX) {
+    if (value_end < value_start) {
         return;
     }
 
-    int esdt_value_end_position = INVALID_INDEX;
-    for (size_t idx = esdt_value_start_position; idx < strlen(data_field); idx++) {
-        if (data_field[idx] == SC_ARGS_SEPARATOR || data_field[idx] == BASE_64_INVALID_CHAR) {
-            esdt_value_end_position = idx - 1;
-            break;
-        }
-    }
-
-    if (esdt_value_end_position == INVALID_INDEX) {
-        esdt_value_end_position = strlen(data_field);
-    }
-
-    if (esdt_value_end_position - esdt_value_start_position + 1 > MAX_ESDT_VALUE_HEX_COUNT) {
+    // 32 hex digits never fit the amount display, whether or not they are
+    // followed by another argument
+    uint32_t value_len = value_end - value_start;
+    if (value_len >= MAX_ESDT_VALUE_HEX_COUNT) {
         tx_context.esdt_value[0] = ESDT_CODE_VALUE_TOO_HIGH;
         tx_context.esdt_value[1] = '\0';
         return;
     }
 
     tx_context.esdt_value[0] = ESDT_CODE_VALUE_OK;
-    size_t num_chars_to_copy = esdt_value_end_position - esdt_value_start_position + 1;
-    memmove(tx_context.esdt_value + 1, data_field + esdt_value_start_position, num_chars_to_copy);
-    tx_context.esdt_value[num_chars_to_copy + 1] = '\0';
+    memmove(tx_context.esdt_value + 1, decoded + value_start, value_len);
+    tx_context.esdt_value[value_len + 1] = '\0';
 }
 
 // verify "chainID" field
-uint16_t verify_chainid(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, CHAINID_FIELD, strlen(CHAINID_FIELD)) == 0) {
-        const char *ticker = TICKER_TESTNET;
-        if (strncmp(tx_hash_context.current_value, MAINNET_CHAIN_ID, strlen(MAINNET_CHAIN_ID)) ==
-            0) {
-            ticker = TICKER_MAINNET;
-        }
-        memmove(tx_context.chain_id,
-                tx_hash_context.current_value,
-                tx_hash_context.current_value_len);
-        set_network(tx_hash_context.current_value);
-
-        if (!gas_to_fee(tx_context.gas_limit,
-                        tx_context.gas_price,
-                        tx_context.data_size,
-                        tx_context.fee,
-                        sizeof(tx_context.fee) - PRETTY_SIZE)) {
-            return ERR_INVALID_FEE;
-        }
-
-        if (!make_amount_pretty(tx_context.amount,
-                                sizeof(tx_context.amount),
-                                ticker,
-                                DECIMAL_PLACES) ||
-            !make_amount_pretty(tx_context.fee, sizeof(tx_context.fee), ticker, DECIMAL_PLACES)) {
-            return ERR_PRETTY_FAILED;
-        }
-        *valid = true;
+uint16_t verify_chainid(void) {
+    const char *ticker = TICKER_TESTNET;
+    if (strncmp(tx_hash_context.current_value, MAINNET_CHAIN_ID, strlen(MAINNET_CHAIN_ID)) == 0) {
+        ticker = TICKER_MAINNET;
+    }
+    memmove(tx_context.chain_id, tx_hash_context.current_value, tx_hash_context.current_value_len);
+    set_network(tx_hash_context.current_value);
+
+    uint128_t fee;
+    gas_to_fee(tx_context.gas_limit, tx_context.gas_price, tx_context.data_size, &fee);
+    if (!format_amount(&fee, DECIMAL_PLACES, ticker, tx_context.fee, sizeof(tx_context.fee))) {
+        return ERR_INVALID_FEE;
+    }
+
+    // the value is formatted from the digits validated by verify_value
+    char digits[sizeof(tx_context.amount)];
+    size_t digits_len = strlen(tx_context.amount);
+    memmove(digits, tx_context.amount, digits_len);
+    if (!format_amount_digits(digits,
+                              digits_len,
+                              DECIMAL_PLACES,
+                              ticker,
+                              tx_context.amount,
+                              sizeof(tx_context.amount))) {
+        return ERR_PRETTY_FAILED;
     }
     return MSG_OK;
 }
@@ -358,132 +341,211 @@ static void set_network(const char *chain_id) {
 }
 
 // verify "version" field
-uint16_t verify_version(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, VERSION_FIELD, strlen(VERSION_FIELD)) == 0) {
-        uint64_t version;
-        if (!parse_int(tx_hash_context.current_value,
-                       strlen(tx_hash_context.current_value),
-                       &version)) {
-            return ERR_INVALID_MESSAGE;
-        }
-        if (version < TX_HASH_VERSION) {
-            return ERR_WRONG_TX_VERSION;
-        }
-        *valid = true;
+uint16_t verify_version(void) {
+    uint64_t version;
+    if (!parse_int(tx_hash_context.current_value,
+                   strlen(tx_hash_context.current_value),
+                   &version)) {
+        return ERR_INVALID_MESSAGE;
+    }
+    if (version < TX_HASH_VERSION) {
+        return ERR_WRONG_TX_VERSION;
     }
     return MSG_OK;
 }
 
 // verify "options" field
-uint16_t verify_options(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, OPTIONS_FIELD, strlen(OPTIONS_FIELD)) == 0) {
-        uint64_t options;
-        if (!parse_int(tx_hash_context.current_value,
-                       strlen(tx_hash_context.current_value),
-                       &options)) {
-            return ERR_INVALID_MESSAGE;
-        }
-        if (options < TX_HASH_OPTIONS) {
-            return ERR_WRONG_TX_OPTIONS;
-        }
-        *valid = true;
+uint16_t verify_options(void) {
+    uint64_t options;
+    if (!parse_int(tx_hash_context.current_value,
+                   strlen(tx_hash_context.current_value),
+                   &options)) {
+        return ERR_INVALID_MESSAGE;
+    }
+    if (options < TX_HASH_OPTIONS) {
+        return ERR_WRONG_TX_OPTIONS;
     }
     return MSG_OK;
 }
 
 // verify "guardian" field
-uint16_t verify_guardian(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, GUARDIAN_ADDR_FIELD, strlen(GUARDIAN_ADDR_FIELD)) ==
-        0) {
-        if (tx_hash_context.current_value_len >= sizeof(tx_context.guardian)) {
-            return ERR_INVALID_MESSAGE;
-        }
-        memmove(tx_context.guardian,
-                tx_hash_context.current_value,
-                tx_hash_context.current_value_len);
-        *valid = true;
+uint16_t verify_guardian(void) {
+    if (tx_hash_context.current_value_len >= sizeof(tx_context.guardian)) {
+        return ERR_INVALID_MESSAGE;
     }
+    memmove(tx_context.guardian, tx_hash_context.current_value, tx_hash_context.current_value_len);
     return MSG_OK;
 }
 
-uint16_t verify_relayer(bool *valid) {
-    if (strncmp(tx_hash_context.current_field, RELAYER_FIELD, strlen(RELAYER_FIELD)) == 0) {
-        if (tx_hash_context.current_value_len >= sizeof(tx_context.relayer)) {
-            return ERR_INVALID_MESSAGE;
-        }
-        memmove(tx_context.relayer,
-                tx_hash_context.current_value,
-                tx_hash_context.current_value_len);
-        *valid = true;
+uint16_t verify_relayer(void) {
+    if (tx_hash_context.current_value_len >= sizeof(tx_context.relayer)) {
+        return ERR_INVALID_MESSAGE;
     }
+    memmove(tx_context.relayer, tx_hash_context.current_value, tx_hash_context.current_value_len);
     return MSG_OK;
 }
 
-// verifies if the field and value are valid and stores them
-uint16_t process_field(void) {
-    if (tx_hash_context.current_field_len == 0 || tx_hash_context.current_value_len == 0) {
-        return ERR_INVALID_MESSAGE;
-    }
-    if (tx_hash_context.current_value_len < MAX_VALUE_LEN) {
-        tx_hash_context.current_value[tx_hash_context.current_value_len++] = '\0';
-    }
-    bool valid_field = false;
-    uint16_t err;
-    err = verify_value(&valid_field);
-    if (err != MSG_OK) {
-        return err;
-    }
-    err = verify_receiver(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+static const char *const field_names[FIELD_COUNT] = {
+    [FIELD_NONCE] = NONCE_FIELD,
+    [FIELD_VALUE] = VALUE_FIELD,
+    [FIELD_RECEIVER] = RECEIVER_FIELD,
+    [FIELD_SENDER] = SENDER_FIELD,
+    [FIELD_GASPRICE] = GASPRICE_FIELD,
+    [FIELD_GASLIMIT] = GASLIMIT_FIELD,
+    [FIELD_DATA] = DATA_FIELD,
+    [FIELD_CHAINID] = CHAINID_FIELD,
+    [FIELD_VERSION] = VERSION_FIELD,
+    [FIELD_OPTIONS] = OPTIONS_FIELD,
+    [FIELD_SENDER_USERNAME] = SENDER_USERNAME_FIELD,
+    [FIELD_RECEIVER_USERNAME] = RECEIVER_USERNAME_FIELD,
+    [FIELD_GUARDIAN] = GUARDIAN_ADDR_FIELD,
+    [FIELD_RELAYER] = RELAYER_FIELD,
+};
+
+// maps a json key to its field id. The length and a distinguishing character
+// select a single candidate, which is then confirmed with one memcmp
+static tx_field_e lookup_field(const char *field, uint8_t len) {
+    tx_field_e candidate = FIELD_UNKNOWN;
+
+    switch (len) {
+        case 4:
+            candidate = FIELD_DATA;
+            break;
+        case 5:
+            candidate = field[0] == 'n' ? FIELD_NONCE : FIELD_VALUE;
+            break;
+        case 6:
+            candidate = FIELD_SENDER;
+            break;
+        case 7:
+            switch (field[0]) {
+                case 'c':
+                    candidate = FIELD_CHAINID;
+                    break;
+                case 'v':
+                    candidate = FIELD_VERSION;
+                    break;
+                case 'o':
+                    candidate = FIELD_OPTIONS;
+                    break;
+                default:
+                    candidate = FIELD_RELAYER;
+                    break;
+            }
+            break;
+        case 8:
+            switch (field[0]) {
+                case 'r':
+                    candidate = FIELD_RECEIVER;
+                    break;
+                case 'g':
+                    // gasPrice, gasLimit and guardian
+                    candidate = field[3] == 'P'   ? FIELD_GASPRICE
+                                : field[3] == 'L' ? FIELD_GASLIMIT
+                                                  : FIELD_GUARDIAN;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case 14:
+            candidate = FIELD_SENDER_USERNAME;
+            break;
+        case 16:
+            candidate = FIELD_RECEIVER_USERNAME;
+            break;
+        default:
+            break;
     }
-    err = verify_gasprice(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+
+    if (candidate == FIELD_UNKNOWN || memcmp(field, field_names[candidate], len) != 0) {
+        return FIELD_UNKNOWN;
     }
-    err = verify_gaslimit(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+    return candidate;
+}
+
+// decodes one base64 character of the data field. Characters arrive one by
+// one, possibly across several chunks, so an incomplete quad is carried in
+// tx_hash_context. Only the first MAX_DATA_DECODED_SIZE bytes are kept, but all
+// of them are counted in data_field_size
+static bool decode_data_char(char c) {
+    uint8_t value = BASE64_DECODE_TABLE[(uint8_t) c];
+    if (value & BASE64_INVALID) {
+        return false;
     }
-    err = verify_data(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+    if (value == BASE64_PAD) {
+        tx_hash_context.data_carry_padding++;
     }
-    err = verify_chainid(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+    tx_hash_context.data_carry =
+        (tx_hash_context.data_carry << 6) | (value & BASE64_VALUE_MASK);
+    if (++tx_hash_context.data_carry_len < 4) {
+        return true;
     }
-    err = verify_version(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+    if (tx_hash_context.data_carry_padding > 2) {
+        return false;
     }
-    err = verify_options(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+
+    char *decoded = tx_context.data + DATA_SIZE_LEN - 1;
+    uint8_t decoded_count = 3 - tx_hash_context.data_carry_padding;
+    for (uint8_t i = 0; i < decoded_count; i++) {
+        char b = BASE64_DISPLAY_CHAR(tx_hash_context.data_carry >> (16 - 8 * i));
+        uint32_t offset = tx_hash_context.data_field_size++;
+        if (offset >= MAX_DATA_DECODED_SIZE) {
+            continue;
+        }
+        // remember where the smart contract arguments start
+        if (b == SC_ARGS_SEPARATOR && tx_context.data_args_count < MAX_DATA_ARGS) {
+            tx_context.data_args[tx_context.data_args_count++] = offset;
+        }
+        decoded[offset] = b;
     }
-    err = verify_guardian(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+    tx_hash_context.data_carry = 0;
+    tx_hash_context.data_carry_len = 0;
+    tx_hash_context.data_carry_padding = 0;
+    return true;
+}
+
+// verifies if the field and value are valid and stores them
+uint16_t process_field(void) {
+    if (tx_hash_context.current_field_len == 0 || tx_hash_context.current_value_len == 0) {
+        return ERR_INVALID_MESSAGE;
     }
-    err = verify_relayer(&valid_field);
-    if (err != MSG_OK) {
-        return err;
+    // the data field is not stored in current_value, other values are at most
+    // MAX_VALUE_LEN long and always leave room for the terminator
+    if (tx_hash_context.current_field_id != FIELD_DATA) {
+        tx_hash_context.current_value[tx_hash_context.current_value_len++] = '\0';
     }
 
-    // verify the rest of the fields that are not displayed
-    valid_field |= strncmp(tx_hash_context.current_field, NONCE_FIELD, strlen(NONCE_FIELD)) == 0;
-    valid_field |= strncmp(tx_hash_context.current_field, SENDER_FIELD, strlen(SENDER_FIELD)) == 0;
-    valid_field |= strncmp(tx_hash_context.current_field,
-                           SENDER_USERNAME_FIELD,
-                           strlen(SENDER_USERNAME_FIELD)) == 0;
-    valid_field |= strncmp(tx_hash_context.current_field,
-                           RECEIVER_USERNAME_FIELD,
-                           strlen(RECEIVER_USERNAME_FIELD)) == 0;
-
-    if (valid_field) {
-        return MSG_OK;
-    } else {
-        return ERR_INVALID_MESSAGE;
+    switch (tx_hash_context.current_field_id) {
+        case FIELD_VALUE:
+            return verify_value();
+        case FIELD_RECEIVER:
+            return verify_receiver();
+        case FIELD_GASPRICE:
+            return verify_gasprice();
+        case FIELD_GASLIMIT:
+            return verify_gaslimit();
+        case FIELD_DATA:
+            return verify_data();
+        case FIELD_CHAINID:
+            return verify_chainid();
+        case FIELD_VERSION:
+            return verify_version();
+        case FIELD_OPTIONS:
+            return verify_options();
+        case FIELD_GUARDIAN:
+            return verify_guardian();
+        case FIELD_RELAYER:
+            return verify_relayer();
+        case FIELD_NONCE:
+            return verify_nonce();
+        // the rest of the fields are accepted but not displayed
+        case FIELD_SENDER:
+        case FIELD_SENDER_USERNAME:
+        case FIELD_RECEIVER_USERNAME:
+            return MSG_OK;
+        default:
+            return ERR_INVALID_MESSAGE;
     }
 }
 
@@ -515,6 +577,9 @@ uint16_t parse_data(const uint8_t *data_buffer, uint16_t data_length) {
                 break;
             case JSON_PROCESSING_FIELD:
                 if (c == '"') {
+                    tx_hash_context.current_field_id =
+                        lookup_field(tx_hash_context.current_field,
+                                     tx_hash_context.current_field_len);
                     tx_hash_context.status = JSON_EXPECTING_COLON;
                     break;
                 }
@@ -533,39 +598,24 @@ uint16_t parse_data(const uint8_t *data_buffer, uint16_t data_length) {
             case JSON_EXPECTING_VALUE:
                 if (c == '"') {
                     tx_hash_context.status = JSON_PROCESSING_STRING_VALUE;
+                    if (tx_hash_context.current_field_id == FIELD_DATA) {
+                        tx_hash_context.data_field_size = 0;
+                        tx_hash_context.data_carry = 0;
+                        tx_hash_context.data_carry_len = 0;
+                        tx_hash_context.data_carry_padding = 0;
+                        tx_context.data_args_count = 0;
+                    }
                     break;
                 }
-                if (!is_digit(c)) {
+                // the data field is only decoded from a string
+                if (!is_digit(c) || tx_hash_context.current_field_id == FIELD_DATA) {
                     return ERR_INVALID_MESSAGE;
                 }
                 tx_hash_context.status = JSON_PROCESSING_NUMERIC_VALUE;
                 tx_hash_context.current_value[tx_hash_context.current_value_len++] = c;
                 break;
-            case JSON_PROCESSING_STRING_VALUE: {
-                bool is_data_field = strncmp(tx_hash_context.current_field,
-                                             DATA_FIELD,
-                                             tx_hash_context.current_field_len) == 0;
+            case JSON_PROCESSING_STRING_VALUE:
                 if (c == '"') {
-                    if (is_data_field) {
-                        uint32_t data_value_len;
-                        // remove additional characters and convert to decoded string length
-                        data_value_len = tx_hash_context.current_value_len / 4 * 3;
-                        //  remove trailing padding chars from count if any
-                        if (tx_hash_context.current_value_len > 2) {
-                            // example:
-                            // "data": "YQ==",
-                            //               ^
-                            // idx is 2 positions ahead of last 2 chars from data value, so
-                            // idx-2 and idx-3 will contain them
-                            if (data_buffer[idx - 2] == '=') {
-                                data_value_len--;
-                            }
-                            if (data_buffer[idx - 3] == '=') {
-                                data_value_len--;
-                            }
-                        }
-                        tx_hash_context.data_field_size = data_value_len;
-                    }
                     uint16_t err = process_field();
                     if (err != MSG_OK) {
                         return err;
@@ -573,16 +623,18 @@ uint16_t parse_data(const uint8_t *data_buffer, uint16_t data_length) {
                     tx_hash_context.status = JSON_EXPECTING_COMMA;
                     break;
                 }
-                if (tx_hash_context.current_value_len >= MAX_VALUE_LEN) {
-                    if (is_data_field && tx_hash_context.current_field_len == strlen(DATA_FIELD)) {
-                        tx_hash_context.current_value_len++;
-                        break;
-                    } else {
+                if (tx_hash_context.current_field_id == FIELD_DATA) {
+                    if (!decode_data_char(c)) {
                         return ERR_INVALID_MESSAGE;
                     }
+                    tx_hash_context.current_value_len++;
+                    break;
+                }
+                if (tx_hash_context.current_value_len >= MAX_VALUE_LEN) {
+                    return ERR_INVALID_MESSAGE;
                 }
                 tx_hash_context.current_value[tx_hash_context.current_value_len++] = c;
-            } break;
+                break;
             case JSON_PROCESSING_NUMERIC_VALUE:
                 if (c == '}') {
                     tx_hash_context.status = JSON_IDLE;
@@ -638,19 +690,15 @@ uint16_t parse_esdt_data(void) {
         return MSG_OK;
     }
 
-    char *amount = tx_context.amount;
-    if (!tostring128(&value, BASE_10, amount, ESDT_VALUE_MAX_LENGTH)) {
-        return ERR_INVALID_AMOUNT;
-    }
-
     if (!esdt_info.valid) {
         return ERR_INVALID_ESDT;
     }
 
-    if (!make_amount_pretty(amount,
-                            sizeof(tx_context.amount),
-                            esdt_info.ticker,
-                            esdt_info.decimals)) {
+    if (!format_amount(&value,
+                       esdt_info.decimals,
+                       esdt_info.ticker,
+                       tx_context.amount,
+                       sizeof(tx_context.amount))) {
         return ERR_PRETTY_FAILED;
     }
 
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <uint256.h>
+
 #include "constants.h"
 #include "sign_tx_hash.h"
 #include "utils.h"
 
+// decoded bytes of the data field kept for display and ESDT parsing, enough
+// for "ESDTTransfer@<identifier>@<value>". Must be >= MAX_DISPLAY_DECODED_SIZE
+#define MAX_DATA_DECODED_SIZE    96
+#define MAX_DISPLAY_DECODED_SIZE (MAX_DISPLAY_DATA_SIZE / 4 * 3)
+// "ESDTTransfer@<identifier>@<value>@..." needs the first three separators
+#define MAX_DATA_ARGS 3
+
 typedef struct {
     char receiver[FULL_ADDRESS_LENGTH];
     char amount[MAX_AMOUNT_LEN + PRETTY_SIZE];
+    uint128_t value;  // the amount before formatting, summed up by the batch sessions
+    uint64_t nonce;  // only meaningful when nonce_valid, counted by the spending windows
+    bool nonce_valid;
     uint64_t gas_limit;
     uint64_t gas_price;
     char fee[MAX_AMOUNT_LEN + PRETTY_SIZE];
-    char data[MAX_DISPLAY_DATA_SIZE + DATA_SIZE_LEN];
+    char data[DATA_SIZE_LEN + MAX_DATA_DECODED_SIZE];
     uint32_t data_size;
+    uint8_t data_args[MAX_DATA_ARGS];  // offsets of the '@' separators in the decoded data
+    uint8_t data_args_count;
     char chain_id[MAX_CHAINID_LEN];
     uint8_t signature[64];
     char esdt_value[MAX_ESDT_VALUE_HEX_COUNT + PRETTY_SIZE];
@@ -25,3 +39,10 @@ extern tx_hash_context_t tx_hash_context;
 
 uint16_t parse_data(const uint8_t *data_buffer, uint16_t data_length);
 uint16_t parse_esdt_data(void);
+bool parse_hex(const char *str, size_t size, uint128_t *result);
+void gas_to_fee(uint64_t gas_limit, uint64_t gas_price, uint32_t data_size, uint128_t *fee);
+bool format_amount(uint128_t *value,
+                   uint8_t decimals,
+                   const char *ticker,
+                   char *out,
+                   size_t max_size);
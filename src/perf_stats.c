@@ -0,0 +1,183 @@
+#include "perf_stats.h"
+
+#ifdef HAVE_PERF_STATS
+
+#include <string.h>
+
+#include "constants.h"
+#include "os.h"
+
+#ifdef SIMULATION
+#include <time.h>
+#endif
+
+// INS 0x00 to 0x16 have their own slot, any other INS is counted in the last
+// one and reported as 0xFF
+#define PERF_STATS_INS_SLOTS 24
+#define PERF_STATS_OTHER_INS 0xFF
+
+typedef struct {
+    uint32_t count;
+    uint32_t bytes;
+} perf_ins_stats_t;
+
+// sections and APDUs are only timed on the host simulation: the device has no
+// timer an app can read, its ticker events come every 100ms and only while the
+// app waits in io_exchange, so it only counts them
+#ifdef SIMULATION
+#define PERF_STATS_TIMING
+#endif
+
+typedef struct {
+    uint32_t count;
+#ifdef PERF_STATS_TIMING
+    uint32_t time;
+#endif
+} perf_section_stats_t;
+
+typedef struct {
+    perf_ins_stats_t ins[PERF_STATS_INS_SLOTS];
+    perf_section_stats_t sections[PERF_SECTION_COUNT];
+#ifdef PERF_STATS_TIMING
+    uint32_t section_start[PERF_SECTION_COUNT];
+    uint32_t apdu_start;
+    uint8_t apdu_ins;
+    uint32_t max_apdu_time;
+    uint8_t max_apdu_ins;
+#endif
+} perf_stats_t;
+
+static perf_stats_t perf_stats;
+
+#ifdef PERF_STATS_TIMING
+// the host build measures microseconds
+#define PERF_STATS_TIME_UNIT_US 1
+
+static uint32_t perf_stats_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) (now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+#else
+// no time measured
+#define PERF_STATS_TIME_UNIT_US 0
+#endif
+
+static uint8_t ins_slot(uint8_t ins) {
+    return ins < PERF_STATS_INS_SLOTS - 1 ? ins : PERF_STATS_INS_SLOTS - 1;
+}
+
+void perf_stats_apdu_begin(uint8_t ins, unsigned int rx) {
+    perf_ins_stats_t *stats = &perf_stats.ins[ins_slot(ins)];
+    stats->count++;
+    stats->bytes += rx;
+#ifdef PERF_STATS_TIMING
+    perf_stats.apdu_ins = ins;
+    perf_stats.apdu_start = perf_stats_now();
+#endif
+}
+
+void perf_stats_apdu_end(void) {
+#ifdef PERF_STATS_TIMING
+    uint32_t elapsed = perf_stats_now() - perf_stats.apdu_start;
+    if (elapsed > perf_stats.max_apdu_time) {
+        perf_stats.max_apdu_time = elapsed;
+        perf_stats.max_apdu_ins = perf_stats.apdu_ins;
+    }
+#endif
+}
+
+void perf_stats_start(perf_section_t section) {
+#ifdef PERF_STATS_TIMING
+    perf_stats.section_start[section] = perf_stats_now();
+#else
+    (void) section;
+#endif
+}
+
+void perf_stats_stop(perf_section_t section) {
+    perf_stats.sections[section].count++;
+#ifdef PERF_STATS_TIMING
+    perf_stats.sections[section].time += perf_stats_now() - perf_stats.section_start[section];
+#endif
+}
+
+static uint8_t *write_u32(uint8_t *buffer, uint32_t value) {
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+    return buffer + 4;
+}
+
+/*
+   summary response on the host simulation:
+   <version> + <time unit in us> + <slowest APDU time> + <slowest APDU INS> +
+       1 byte        4 bytes              4 bytes              1 byte
+   5 x (<count> + <time>) for derivation, hashing, signing, parsing and public key
+         4 bytes  4 bytes
+
+   summary response on the device, which does not time anything:
+   <version> + <time unit = 0> + 5 x <count>
+       1 byte       4 bytes        4 bytes
+
+   per INS response, only for the INS received at least once:
+   n x (<INS> + <count> + <bytes>)
+       1 byte   4 bytes   4 bytes
+*/
+uint16_t handle_get_perf_stats(uint8_t p1, uint8_t p2, volatile unsigned int *tx) {
+    uint8_t *out = G_io_apdu_buffer;
+
+    if (p1 != P1_PERF_STATS_READ && p1 != P1_PERF_STATS_READ_RESET) {
+        return ERR_INVALID_P1;
+    }
+
+    switch (p2) {
+        case P2_PERF_STATS_SUMMARY:
+            *out++ = PERF_STATS_VERSION;
+            out = write_u32(out, PERF_STATS_TIME_UNIT_US);
+#ifdef PERF_STATS_TIMING
+            out = write_u32(out, perf_stats.max_apdu_time);
+            *out++ = perf_stats.max_apdu_ins;
+#endif
+            for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+                out = write_u32(out, perf_stats.sections[i].count);
+#ifdef PERF_STATS_TIMING
+                out = write_u32(out, perf_stats.sections[i].time);
+#endif
+            }
+            break;
+
+        case P2_PERF_STATS_PER_INS:
+            for (int i = 0; i < PERF_STATS_INS_SLOTS; i++) {
+                if (perf_stats.ins[i].count == 0) {
+                    continue;
+                }
+                *out++ = i == PERF_STATS_INS_SLOTS - 1 ? PERF_STATS_OTHER_INS : i;
+                out = write_u32(out, perf_stats.ins[i].count);
+                out = write_u32(out, perf_stats.ins[i].bytes);
+            }
+            break;
+
+        default:
+            return ERR_INVALID_ARGUMENTS;
+    }
+
+    if (p1 == P1_PERF_STATS_READ_RESET) {
+#ifdef PERF_STATS_TIMING
+        // keep timing the APDU being handled, it ends up in the fresh counters
+        uint32_t apdu_start = perf_stats.apdu_start;
+        uint8_t apdu_ins = perf_stats.apdu_ins;
+        memset(&perf_stats, 0, sizeof(perf_stats));
+        perf_stats.apdu_start = apdu_start;
+        perf_stats.apdu_ins = apdu_ins;
+#else
+        memset(&perf_stats, 0, sizeof(perf_stats));
+#endif
+    }
+
+    *tx = out - G_io_apdu_buffer;
+    return MSG_OK;
+}
+
+#endif  // HAVE_PERF_STATS
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+// Performance counters, compiled in only with HAVE_PERF_STATS (make
+// PERF_STATS=1): APDU count and bytes per INS, number of runs of each section
+// and, on the host simulation only, time spent per section and the slowest
+// APDU, read back with INS_GET_PERF_STATS. Without the define every macro
+// below expands to nothing.
+
+#define PERF_STATS_VERSION 2
+
+// P1 of INS_GET_PERF_STATS
+#define P1_PERF_STATS_READ       0x00
+#define P1_PERF_STATS_READ_RESET 0x01
+
+// P2 of INS_GET_PERF_STATS
+#define P2_PERF_STATS_SUMMARY 0x00
+#define P2_PERF_STATS_PER_INS 0x01
+
+typedef enum {
+    PERF_SECTION_DERIVATION,
+    PERF_SECTION_HASHING,
+    PERF_SECTION_SIGNING,
+    PERF_SECTION_PARSING,
+    PERF_SECTION_PUBLIC_KEY,
+    PERF_SECTION_COUNT,
+} perf_section_t;
+
+#ifdef HAVE_PERF_STATS
+
+void perf_stats_apdu_begin(uint8_t ins, unsigned int rx);
+void perf_stats_apdu_end(void);
+void perf_stats_start(perf_section_t section);
+void perf_stats_stop(perf_section_t section);
+
+// writes the counters selected by p2 to G_io_apdu_buffer and clears them
+// afterwards if p1 asks for it
+uint16_t handle_get_perf_stats(uint8_t p1, uint8_t p2, volatile unsigned int *tx);
+
+#define PERF_STATS_APDU_BEGIN(ins, rx) perf_stats_apdu_begin(ins, rx)
+#define PERF_STATS_APDU_END()          perf_stats_apdu_end()
+#define PERF_STATS_START(section)      perf_stats_start(section)
+#define PERF_STATS_STOP(section)       perf_stats_stop(section)
+
+#else
+
+#define PERF_STATS_APDU_BEGIN(ins, rx) \
+    do {                               \
+        (void) (ins);                  \
+        (void) (rx);                   \
+    } while (0)
+#define PERF_STATS_APDU_END() \
+    do {                      \
+    } while (0)
+#define PERF_STATS_START(section) \
+    do {                          \
+    } while (0)
+#define PERF_STATS_STOP(section) \
+    do {                         \
+    } while (0)
+
+#endif  // HAVE_PERF_STATS
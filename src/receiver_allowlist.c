@@ -0,0 +1,82 @@
+#include "receiver_allowlist.h"
+#include "globals.h"
+#include "address_helpers.h"
+
+/*
+   The receivers allowed by the signing policy are kept as their public keys, sorted so that the
+   receiver of a transaction is found with a binary search on raw 32-byte keys. The host sends the
+   keys in increasing order, so that they are only ever appended to the list in flash.
+*/
+
+typedef struct receiver_allowlist_t {
+    uint16_t count;
+    uint8_t keys[MAX_ALLOWED_RECEIVERS][PUBLIC_KEY_LEN];
+} receiver_allowlist_t;
+
+static const receiver_allowlist_t N_allowlist_real;
+#define N_allowlist (*(volatile receiver_allowlist_t *) PIC(&N_allowlist_real))
+
+static const receiver_allowlist_t *allowlist(void) {
+    return (const receiver_allowlist_t *) &N_allowlist;
+}
+
+void clear_allowed_receivers(void) {
+    uint16_t count = 0;
+    nvm_write((void *) &N_allowlist.count, &count, sizeof(count));
+}
+
+uint16_t allowed_receivers_count(void) {
+    return N_allowlist.count;
+}
+
+const uint8_t *allowed_receiver(uint16_t index) {
+    return allowlist()->keys[index];
+}
+
+uint16_t add_allowed_receivers(const uint8_t *keys, uint16_t length) {
+    uint16_t count = N_allowlist.count;
+    uint16_t added = length / PUBLIC_KEY_LEN;
+    const uint8_t *previous = count > 0 ? allowed_receiver(count - 1) : NULL;
+
+    if (added == 0 || length % PUBLIC_KEY_LEN != 0) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+    if (added > MAX_ALLOWED_RECEIVERS - count) {
+        return ERR_INDEX_OUT_OF_BOUNDS;
+    }
+    for (uint16_t i = 0; i < added; i++) {
+        const uint8_t *key = keys + i * PUBLIC_KEY_LEN;
+        if (previous != NULL && memcmp(previous, key, PUBLIC_KEY_LEN) >= 0) {
+            return ERR_INVALID_ARGUMENTS;
+        }
+        previous = key;
+    }
+
+    nvm_write((void *) N_allowlist.keys[count], (void *) keys, length);
+    count += added;
+    nvm_write((void *) &N_allowlist.count, &count, sizeof(count));
+    return MSG_OK;
+}
+
+bool is_allowed_receiver(const char *receiver) {
+    uint8_t key[PUBLIC_KEY_LEN];
+    uint16_t low = 0;
+    uint16_t high = allowed_receivers_count();
+
+    if (!get_binary_from_address_bech32(receiver, key)) {
+        return false;
+    }
+    while (low < high) {
+        uint16_t middle = low + (high - low) / 2;
+        int order = memcmp(allowed_receiver(middle), key, PUBLIC_KEY_LEN);
+        if (order == 0) {
+            return true;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,28 @@
+#ifndef _RECEIVER_ALLOWLIST_H_
+#define _RECEIVER_ALLOWLIST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "constants.h"
+
+// every receiver is shown in the review of the policy, which on Stax indexes its pairs, the
+// receivers among them, on 8 bits
+#if defined(TARGET_NANOS)
+#define MAX_ALLOWED_RECEIVERS 256
+#elif defined(TARGET_STAX)
+#define MAX_ALLOWED_RECEIVERS 240
+#else
+#define MAX_ALLOWED_RECEIVERS 512
+#endif
+
+void clear_allowed_receivers(void);
+uint16_t allowed_receivers_count(void);
+// allowed_receiver gives the public key at index in the sorted list
+const uint8_t *allowed_receiver(uint16_t index);
+// add_allowed_receivers appends public keys greater than the ones already in the list
+uint16_t add_allowed_receivers(const uint8_t *keys, uint16_t length);
+// is_allowed_receiver looks up the bech32 address of a receiver in the list
+bool is_allowed_receiver(const char *receiver);
+
+#endif
@@ -1,5 +1,6 @@
 #include "globals.h"
 #include "utils.h"
+#include "get_private_key.h"
 
 // set the account and address index for the derivation path
 uint16_t handle_set_address(uint8_t *data_buffer, uint16_t data_length) {
@@ -12,6 +13,10 @@ uint16_t handle_set_address(uint8_t *data_buffer, uint16_t data_length) {
     account = read_uint32_be(data_buffer);
     address_index = read_uint32_be(data_buffer + sizeof(uint32_t));
 
+    if (account != bip32_account || address_index != bip32_address_index) {
+        clear_private_key_cache();
+    }
+
     bip32_account = account;
     bip32_address_index = address_index;
 
@@ -1,5 +1,6 @@
 #include "sign_msg.h"
 #include "get_private_key.h"
+#include "perf_stats.h"
 #include "utils.h"
 #include "menu.h"
 
@@ -118,12 +119,14 @@ static bool sign_message(void) {
         return false;
     }
 
+    PERF_STATS_START(PERF_SECTION_SIGNING);
     ret_code = cx_eddsa_sign_no_throw(&private_key,
                                       CX_SHA512,
                                       msg_context.hash,
                                       HASH_LEN,
                                       msg_context.signature,
                                       MESSAGE_SIGNATURE_LEN);
+    PERF_STATS_STOP(PERF_SECTION_SIGNING);
     if (ret_code != 0) {
         success = false;
     }
@@ -132,10 +135,10 @@ static bool sign_message(void) {
     return success;
 }
 
-void handle_sign_msg(uint8_t p1,
-                     uint8_t *data_buffer,
-                     uint16_t data_length,
-                     volatile unsigned int *flags) {
+uint16_t handle_sign_msg(uint8_t p1,
+                         uint8_t *data_buffer,
+                         uint16_t data_length,
+                         volatile unsigned int *flags) {
     /*
        data buffer structure should be:
        <message length> + <message>
@@ -152,7 +155,7 @@ void handle_sign_msg(uint8_t p1,
         // first 4 bytes from data_buffer should be the message length (big endian
         // uint32)
         if (data_length < 4) {
-            THROW(ERR_INVALID_MESSAGE);
+            return ERR_INVALID_MESSAGE;
         }
         app_state = APP_STATE_SIGNING_MESSAGE;
         msg_context.len = U4BE(data_buffer, 0);
@@ -161,7 +164,7 @@ void handle_sign_msg(uint8_t p1,
         // initialize hash with the constant string to prepend
         err = cx_keccak_init_no_throw(&sha3_context, SHA3_KECCAK_BITS);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
         err = cx_hash_no_throw((cx_hash_t *) &sha3_context,
                                0,
@@ -170,7 +173,7 @@ void handle_sign_msg(uint8_t p1,
                                NULL,
                                0);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
 
         // convert message length to string and store it in the variable
@@ -185,39 +188,43 @@ void handle_sign_msg(uint8_t p1,
                                NULL,
                                0);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
     } else {
         if (p1 != P1_MORE) {
-            THROW(ERR_INVALID_P1);
+            return ERR_INVALID_P1;
         }
         if (app_state != APP_STATE_SIGNING_MESSAGE) {
-            THROW(ERR_INVALID_MESSAGE);
+            return ERR_INVALID_MESSAGE;
         }
     }
     if (data_length > msg_context.len) {
-        THROW(ERR_MESSAGE_TOO_LONG);
+        return ERR_MESSAGE_TOO_LONG;
     }
 
     // add the received message part to the hash and decrease the remaining length
+    PERF_STATS_START(PERF_SECTION_HASHING);
     err = cx_hash_no_throw((cx_hash_t *) &sha3_context, 0, data_buffer, data_length, NULL, 0);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
     if (err != CX_OK) {
-        THROW(err);
+        return err;
     }
     msg_context.len -= data_length;
     if (msg_context.len != 0) {
-        THROW(MSG_OK);
+        return MSG_OK;
     }
 
     // finalize hash, compute it and store it in `msg_context.strhash` for display
+    PERF_STATS_START(PERF_SECTION_HASHING);
     err = cx_hash_no_throw((cx_hash_t *) &sha3_context,
                            CX_LAST,
                            data_buffer,
                            0,
                            msg_context.hash,
                            HASH_LEN);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
     if (err != CX_OK) {
-        THROW(err);
+        return err;
     }
 
     convert_to_hex_str(msg_context.strhash,
@@ -228,7 +235,7 @@ void handle_sign_msg(uint8_t p1,
     // sign the hash
     if (!sign_message()) {
         init_msg_context();
-        THROW(ERR_SIGNATURE_FAILED);
+        return ERR_SIGNATURE_FAILED;
     }
 
     app_state = APP_STATE_IDLE;
@@ -239,4 +246,5 @@ void handle_sign_msg(uint8_t p1,
     ux_flow_init(0, ux_sign_msg_flow, NULL);
 #endif
     *flags |= IO_ASYNCH_REPLY;
+    return MSG_OK;
 }
@@ -1,6 +1,7 @@
 #include "sign_msg_auth_token.h"
 #include "address_helpers.h"
 #include "get_private_key.h"
+#include "perf_stats.h"
 #include "utils.h"
 #include "menu.h"
 
@@ -269,12 +270,14 @@ static bool sign_auth_token(void) {
         return false;
     }
 
+    PERF_STATS_START(PERF_SECTION_SIGNING);
     int ret_code = cx_eddsa_sign_no_throw(&private_key,
                                           CX_SHA512,
                                           token_auth_context.hash,
                                           HASH_LEN,
                                           token_auth_context.signature,
                                           MESSAGE_SIGNATURE_LEN);
+    PERF_STATS_STOP(PERF_SECTION_SIGNING);
     if (ret_code != 0) {
         success = false;
     }
@@ -283,10 +286,10 @@ static bool sign_auth_token(void) {
     return success;
 }
 
-void handle_auth_token(uint8_t p1,
-                       uint8_t *data_buffer,
-                       uint16_t data_length,
-                       volatile unsigned int *flags) {
+uint16_t handle_auth_token(uint8_t p1,
+                           uint8_t *data_buffer,
+                           uint16_t data_length,
+                           volatile unsigned int *flags) {
     /*
         data buffer structure should be:
         <account index> + <address index> + <token length> + <token>
@@ -305,7 +308,7 @@ void handle_auth_token(uint8_t p1,
 
         // check that the indexes and the length are valid
         if (data_length < AUTH_TOKEN_ADDRESS_INDICES_SIZE + AUTH_TOKEN_TOKEN_LEN_FIELD_SIZE) {
-            THROW(ERR_INVALID_MESSAGE);
+            return ERR_INVALID_MESSAGE;
         }
 
         uint8_t public_key[PUBLIC_KEY_LEN];
@@ -313,7 +316,7 @@ void handle_auth_token(uint8_t p1,
         uint32_t const account_index = read_uint32_be(data_buffer);
         uint32_t const address_index = read_uint32_be(data_buffer + sizeof(uint32_t));
         if (!get_public_key(account_index, address_index, public_key)) {
-            THROW(ERR_INVALID_ARGUMENTS);
+            return ERR_INVALID_ARGUMENTS;
         }
 
         get_address_bech32_from_binary(public_key, token_auth_context.address);
@@ -336,7 +339,7 @@ void handle_auth_token(uint8_t p1,
         // initialize hash with the constant string to prepend
         err = cx_keccak_init_no_throw(&sha3_context, SHA3_KECCAK_BITS);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
 
         err = cx_hash_no_throw((cx_hash_t *) &sha3_context,
@@ -346,7 +349,7 @@ void handle_auth_token(uint8_t p1,
                                NULL,
                                0);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
 
         // convert message length to string and store it in the variable `tmp`
@@ -361,7 +364,7 @@ void handle_auth_token(uint8_t p1,
                                NULL,
                                0);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
 
         // add the message length to the hash
@@ -372,46 +375,50 @@ void handle_auth_token(uint8_t p1,
                                NULL,
                                0);
         if (err != CX_OK) {
-            THROW(err);
+            return err;
         }
     } else {
         if (p1 != P1_MORE) {
-            THROW(ERR_INVALID_P1);
+            return ERR_INVALID_P1;
         }
         if (app_state != APP_STATE_SIGNING_MESSAGE) {
-            THROW(ERR_INVALID_MESSAGE);
+            return ERR_INVALID_MESSAGE;
         }
     }
     if (data_length > token_auth_context.len) {
-        THROW(ERR_MESSAGE_TOO_LONG);
+        return ERR_MESSAGE_TOO_LONG;
     }
 
     // add the received message part to the hash and decrease the remaining length
+    PERF_STATS_START(PERF_SECTION_HASHING);
     err = cx_hash_no_throw((cx_hash_t *) &sha3_context, 0, data_buffer, data_length, NULL, 0);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
     if (err != CX_OK) {
-        THROW(err);
+        return err;
     }
 
     token_auth_context.len -= data_length;
     if (token_auth_context.len != 0) {
-        THROW(MSG_OK);
+        return MSG_OK;
     }
 
     // finalize hash and compute it
+    PERF_STATS_START(PERF_SECTION_HASHING);
     err = cx_hash_no_throw((cx_hash_t *) &sha3_context,
                            CX_LAST,
                            data_buffer,
                            0,
                            token_auth_context.hash,
                            HASH_LEN);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
     if (err != CX_OK) {
-        THROW(err);
+        return err;
     }
 
     // sign the hash
     if (!sign_auth_token()) {
         init_auth_token_context();
-        THROW(ERR_SIGNATURE_FAILED);
+        return ERR_SIGNATURE_FAILED;
     }
 
     char display[AUTH_TOKEN_DISPLAY_MAX_SIZE];
@@ -423,7 +430,7 @@ void handle_auth_token(uint8_t p1,
         memmove(token_auth_context.token, display, strlen(display));
         token_auth_context.token[strlen(display)] = '\0';
     } else if (ret_code == AUTH_TOKEN_BAD_REQUEST_RET_CODE) {
-        THROW(ERR_INVALID_MESSAGE);
+        return ERR_INVALID_MESSAGE;
     }
 
     app_state = APP_STATE_IDLE;
@@ -434,4 +441,5 @@ void handle_auth_token(uint8_t p1,
     ux_flow_init(0, ux_auth_token_msg_flow, NULL);
 #endif
     *flags |= IO_ASYNCH_REPLY;
+    return MSG_OK;
 }
@@ -0,0 +1,497 @@
+#include "sign_tx_batch.h"
+#include "address_helpers.h"
+#include "get_private_key.h"
+#include "globals.h"
+#include "parse_tx.h"
+#include "perf_stats.h"
+#include "signing_policy.h"
+#include "utils.h"
+#include "ux.h"
+#include <uint256.h>
+#include "menu.h"
+
+#ifdef HAVE_NBGL
+#include "nbgl_use_case.h"
+#endif
+
+/*
+   A batch signs plain EGLD transfers of the selected account after a single review of their
+   summary:
+
+   1. the transactions are streamed like with INS_SIGN_TX_HASH: the first chunk of the first one
+      with P1_FIRST, the first chunk of the next ones with P1_BATCH_NEXT_TX, the other chunks with
+      P1_MORE. The last chunk of each transaction is answered with its ticket:
+      <transaction hash> + <previous chain>
+            32 bytes          32 bytes
+      where chain = keccak(previous chain + transaction hash), starting from 32 zero bytes
+   2. P1_BATCH_REVIEW shows the number of transactions, the total amount and fee, the number of
+      receivers and the network, and is answered once the user approved or rejected the batch
+   3. P1_BATCH_SIGN sends the hashes of the next transactions to sign, from the last transaction
+      to the first one, followed by the previous chain of the earliest of them:
+      n x <transaction hash> + <previous chain>
+            32 bytes             32 bytes
+      and gets their signatures in the same order, up to MAX_BATCH_SIGN_COUNT at a time:
+      <n> + n x <signature>
+      1 byte     64 bytes
+      With a single transaction the request is its ticket.
+
+   The device only keeps the last chain value, which commits to all the transaction hashes, so
+   the size of a batch is not bound by the RAM.
+
+   A batch only lives through consecutive INS_SIGN_TX_BATCH: any other command, an IO reset or
+   BATCH_TIMEOUT_TICKS without a signature once approved drop it.
+
+   All the transactions are signed with the account selected when the batch started. When the
+   signing policy has spending limits, each transaction is counted in its window as it arrives,
+   and one that does not fit drops the batch. A batch dropped or rejected before its approval
+   gives back what it counted; once approved, its transactions stay counted even if some of them
+   are never signed.
+*/
+
+typedef enum { BATCH_IDLE, BATCH_RECEIVING, BATCH_REVIEWING, BATCH_APPROVED } batch_state_t;
+
+typedef struct {
+    batch_state_t state;
+    uint16_t count;  // transactions received, then left to sign
+    uint8_t chain[HASH_LEN];
+    char chain_id[MAX_CHAINID_LEN];
+    uint128_t total_value;
+    uint128_t total_fee;
+    uint8_t receivers[MAX_BATCH_RECEIVERS][PUBLIC_KEY_LEN];  // keys of the distinct receivers
+    uint8_t receivers_count;
+    bool receivers_overflow;
+    uint32_t account;
+    uint32_t address_index;
+    uint16_t idle_ticks;
+    char count_str[MAX_UINT32_LEN + 1];
+    char receivers_str[sizeof("more than ") + MAX_UINT32_LEN];
+} batch_context_t;
+
+static batch_context_t batch_context;
+
+void init_batch_context(void) {
+    if (batch_context.state == BATCH_RECEIVING || batch_context.state == BATCH_REVIEWING) {
+        rollback_spending();
+    }
+    memset(&batch_context, 0, sizeof(batch_context));
+}
+
+void batch_context_tick(void) {
+    if (batch_context.state != BATCH_APPROVED) {
+        return;
+    }
+    batch_context.idle_ticks++;
+    if (batch_context.idle_ticks >= BATCH_TIMEOUT_TICKS) {
+        init_batch_context();
+    }
+}
+
+static void abort_batch(void) {
+    init_batch_context();
+    init_tx_context();
+}
+
+static void approve_batch(bool back_to_idle) {
+    batch_context.state = BATCH_APPROVED;
+    send_response(0, true, back_to_idle);
+}
+
+static void reject_batch(bool back_to_idle) {
+    init_batch_context();
+    send_response(0, false, back_to_idle);
+}
+
+#if defined(TARGET_STAX)
+
+static nbgl_layoutTagValueList_t layout;
+static nbgl_layoutTagValue_t pairs_list[5];
+
+static const nbgl_pageInfoLongPress_t review_final_long_press = {
+    .text = "Sign all transactions\non " APPNAME " network?",
+    .icon = &C_icon_multiversx_logo_64x64,
+    .longPressText = "Hold to sign",
+    .longPressToken = 0,
+    .tuneId = TUNE_TAP_CASUAL,
+};
+
+static void batch_rejection(void) {
+    reject_batch(false);
+    nbgl_useCaseStatus("Transactions\nrejected", false, ui_idle);
+}
+
+static void reject_batch_choice(void) {
+    nbgl_useCaseConfirm("Reject transactions?",
+                        NULL,
+                        "Yes, reject",
+                        "Go back to transactions",
+                        batch_rejection);
+}
+
+static void review_final_callback(bool confirmed) {
+    if (confirmed) {
+        approve_batch(false);
+        nbgl_useCaseStatus("TRANSACTIONS\nSIGNED", true, ui_idle);
+    } else {
+        reject_batch_choice();
+    }
+}
+
+static void start_review(void) {
+    pairs_list[0].item = "Transactions";
+    pairs_list[0].value = batch_context.count_str;
+    pairs_list[1].item = "Total amount";
+    pairs_list[1].value = tx_context.amount;
+    pairs_list[2].item = "Total fee";
+    pairs_list[2].value = tx_context.fee;
+    pairs_list[3].item = "Receivers";
+    pairs_list[3].value = batch_context.receivers_str;
+    pairs_list[4].item = "Network";
+    pairs_list[4].value = tx_context.network;
+
+    layout.nbMaxLinesForValue = 0;
+    layout.smallCaseForValue = false;
+    layout.wrapping = true;
+    layout.pairs = pairs_list;
+    layout.nbPairs = ARRAY_COUNT(pairs_list);
+
+    nbgl_useCaseStaticReview(&layout,
+                             &review_final_long_press,
+                             "Reject transactions",
+                             review_final_callback);
+}
+
+static void ui_sign_tx_batch_nbgl(void) {
+    nbgl_useCaseReviewStart(&C_icon_multiversx_logo_64x64,
+                            "Review batch of\nEGLD transfers on\n" APPNAME " network",
+                            "",
+                            "Reject transactions",
+                            start_review,
+                            reject_batch_choice);
+}
+
+#else
+
+// UI for confirming the summary of the batch on screen
+UX_STEP_NOCB(ux_sign_tx_batch_flow_1_step,
+             bnnn_paging,
+             {
+                 .title = "Transactions",
+                 .text = batch_context.count_str,
+             });
+UX_STEP_NOCB(ux_sign_tx_batch_flow_2_step,
+             bnnn_paging,
+             {
+                 .title = "Total amount",
+                 .text = tx_context.amount,
+             });
+UX_STEP_NOCB(ux_sign_tx_batch_flow_3_step,
+             bnnn_paging,
+             {
+                 .title = "Total fee",
+                 .text = tx_context.fee,
+             });
+UX_STEP_NOCB(ux_sign_tx_batch_flow_4_step,
+             bnnn_paging,
+             {
+                 .title = "Receivers",
+                 .text = batch_context.receivers_str,
+             });
+UX_STEP_NOCB(ux_sign_tx_batch_flow_5_step,
+             bnnn_paging,
+             {
+                 .title = "Network",
+                 .text = tx_context.network,
+             });
+UX_STEP_VALID(ux_sign_tx_batch_flow_6_step,
+              pb,
+              approve_batch(true),
+              {
+                  &C_icon_validate_14,
+                  "Sign all",
+              });
+UX_STEP_VALID(ux_sign_tx_batch_flow_7_step,
+              pb,
+              reject_batch(true),
+              {
+                  &C_icon_crossmark,
+                  "Reject",
+              });
+
+UX_FLOW(ux_sign_tx_batch_flow,
+        &ux_sign_tx_batch_flow_1_step,
+        &ux_sign_tx_batch_flow_2_step,
+        &ux_sign_tx_batch_flow_3_step,
+        &ux_sign_tx_batch_flow_4_step,
+        &ux_sign_tx_batch_flow_5_step,
+        &ux_sign_tx_batch_flow_6_step,
+        &ux_sign_tx_batch_flow_7_step);
+
+#endif
+
+// add_receiver counts the receiver if its public key was not seen yet, false if it is no address
+static bool add_receiver(const char *receiver) {
+    uint8_t key[PUBLIC_KEY_LEN];
+
+    if (!get_binary_from_address_bech32(receiver, key)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < batch_context.receivers_count; i++) {
+        if (memcmp(batch_context.receivers[i], key, PUBLIC_KEY_LEN) == 0) {
+            return true;
+        }
+    }
+    if (batch_context.receivers_count == MAX_BATCH_RECEIVERS) {
+        batch_context.receivers_overflow = true;
+        return true;
+    }
+    memmove(batch_context.receivers[batch_context.receivers_count++], key, PUBLIC_KEY_LEN);
+    return true;
+}
+
+// adds value to total, false on overflow
+static bool add_to_total(uint128_t *total, uint128_t *value) {
+    uint128_t sum;
+    add128(total, value, &sum);
+    if (gt128(total, &sum)) {
+        return false;
+    }
+    *total = sum;
+    return true;
+}
+
+// chain = keccak(previous + hash), chain may be previous
+static int chain_hash(const uint8_t *previous, const uint8_t *hash, uint8_t *chain) {
+    int err = cx_keccak_init_no_throw(&sha3_context, SHA3_KECCAK_BITS);
+    if (err == CX_OK) {
+        err = cx_hash_no_throw((cx_hash_t *) &sha3_context, 0, previous, HASH_LEN, NULL, 0);
+    }
+    if (err == CX_OK) {
+        err =
+            cx_hash_no_throw((cx_hash_t *) &sha3_context, CX_LAST, hash, HASH_LEN, chain, HASH_LEN);
+    }
+    return err;
+}
+
+static bool is_plain_transfer(void) {
+    return tx_context.data_size == 0 && tx_context.receiver[0] != '\0' &&
+           tx_context.chain_id[0] != '\0' && tx_context.guardian[0] == '\0' &&
+           tx_context.relayer[0] == '\0';
+}
+
+// add_tx_to_batch accounts for the fully parsed transaction and writes its ticket
+static uint16_t add_tx_to_batch(volatile unsigned int *tx) {
+    uint8_t *ticket = G_io_apdu_buffer;
+    uint128_t fee;
+
+    if (!is_plain_transfer()) {
+        return ERR_NOT_PLAIN_TRANSFER;
+    }
+    if (batch_context.count == 0) {
+        memmove(batch_context.chain_id, tx_context.chain_id, MAX_CHAINID_LEN);
+        batch_context.account = bip32_account;
+        batch_context.address_index = bip32_address_index;
+    } else if (strncmp(batch_context.chain_id, tx_context.chain_id, MAX_CHAINID_LEN) != 0) {
+        return ERR_NOT_PLAIN_TRANSFER;
+    } else if (batch_context.account != bip32_account ||
+               batch_context.address_index != bip32_address_index) {
+        // the spending is counted for the selected account
+        return ERR_INVALID_MESSAGE;
+    }
+
+    gas_to_fee(tx_context.gas_limit, tx_context.gas_price, tx_context.data_size, &fee);
+    if (!add_to_total(&batch_context.total_value, &tx_context.value) ||
+        !add_to_total(&batch_context.total_fee, &fee)) {
+        return ERR_AMOUNT_TOO_LONG;
+    }
+    if (!add_receiver(tx_context.receiver)) {
+        return ERR_NOT_PLAIN_TRANSFER;
+    }
+    if (!policy_count_batch_tx()) {
+        return ERR_SPENDING_LIMIT;
+    }
+
+    PERF_STATS_START(PERF_SECTION_HASHING);
+    int err = cx_hash_no_throw((cx_hash_t *) &sha3_context, CX_LAST, NULL, 0, ticket, HASH_LEN);
+    if (err == CX_OK) {
+        memmove(ticket + HASH_LEN, batch_context.chain, HASH_LEN);
+        err = chain_hash(batch_context.chain, ticket, batch_context.chain);
+    }
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
+    if (err != CX_OK) {
+        return ERR_SIGNATURE_FAILED;
+    }
+
+    batch_context.count++;
+    *tx = BATCH_TICKET_LEN;
+    return MSG_OK;
+}
+
+static uint16_t review_batch(volatile unsigned int *flags) {
+    if (batch_context.state != BATCH_RECEIVING || app_state != APP_STATE_SIGNING_BATCH ||
+        tx_hash_context.status != JSON_IDLE || batch_context.count == 0) {
+        return ERR_INVALID_MESSAGE;
+    }
+
+    const char *ticker = TICKER_TESTNET;
+    if (strncmp(batch_context.chain_id, MAINNET_CHAIN_ID, strlen(MAINNET_CHAIN_ID)) == 0) {
+        ticker = TICKER_MAINNET;
+    }
+    // the amount and fee of the last transaction give way to the totals
+    if (!format_amount(&batch_context.total_value,
+                       DECIMAL_PLACES,
+                       ticker,
+                       tx_context.amount,
+                       sizeof(tx_context.amount)) ||
+        !format_amount(&batch_context.total_fee,
+                       DECIMAL_PLACES,
+                       ticker,
+                       tx_context.fee,
+                       sizeof(tx_context.fee))) {
+        abort_batch();
+        return ERR_AMOUNT_TOO_LONG;
+    }
+
+    uint32_t_to_char_array(batch_context.count, batch_context.count_str);
+    if (batch_context.receivers_overflow) {
+        memmove(batch_context.receivers_str, "more than ", sizeof("more than ") - 1);
+        uint32_t_to_char_array(MAX_BATCH_RECEIVERS,
+                               batch_context.receivers_str + sizeof("more than ") - 1);
+    } else {
+        uint32_t_to_char_array(batch_context.receivers_count, batch_context.receivers_str);
+    }
+
+    batch_context.state = BATCH_REVIEWING;
+    app_state = APP_STATE_IDLE;
+
+#if defined(TARGET_STAX)
+    ui_sign_tx_batch_nbgl();
+#else
+    ux_flow_init(0, ux_sign_tx_batch_flow, NULL);
+#endif
+    *flags |= IO_ASYNCH_REPLY;
+    return MSG_OK;
+}
+
+// sign_batch_txs checks the hashes against the chain and writes their signatures to the IO buffer
+static uint16_t sign_batch_txs(const uint8_t *data_buffer,
+                               uint16_t data_length,
+                               volatile unsigned int *tx) {
+    cx_ecfp_private_key_t private_key;
+    uint8_t hash[HASH_LEN];
+    uint8_t chain[HASH_LEN];
+
+    if (batch_context.state != BATCH_APPROVED) {
+        return ERR_INVALID_MESSAGE;
+    }
+    if (data_length % HASH_LEN != 0 || data_length < 2 * HASH_LEN) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+    uint8_t count = data_length / HASH_LEN - 1;
+    if (count > MAX_BATCH_SIGN_COUNT || count > batch_context.count) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+
+    // rebuild the chain from the previous value, the earliest transaction is the last hash
+    const uint8_t *previous = data_buffer + count * HASH_LEN;
+    memmove(chain, previous, HASH_LEN);
+    for (int i = count - 1; i >= 0; i--) {
+        if (chain_hash(chain, data_buffer + i * HASH_LEN, chain) != CX_OK) {
+            return ERR_SIGNATURE_FAILED;
+        }
+    }
+    if (memcmp(chain, batch_context.chain, HASH_LEN) != 0) {
+        return ERR_INVALID_MESSAGE;
+    }
+    memmove(batch_context.chain, previous, HASH_LEN);
+
+    if (!get_private_key(batch_context.account, batch_context.address_index, &private_key)) {
+        abort_batch();
+        return ERR_SIGNATURE_FAILED;
+    }
+    // the hashes sit in the IO buffer, which receives the signatures: going from the last one,
+    // a signature only overwrites hashes already signed
+    int err = CX_OK;
+    for (int i = count - 1; i >= 0 && err == CX_OK; i--) {
+        memmove(hash, data_buffer + i * HASH_LEN, HASH_LEN);
+        PERF_STATS_START(PERF_SECTION_SIGNING);
+        err = cx_eddsa_sign_no_throw(&private_key,
+                                     CX_SHA512,
+                                     hash,
+                                     HASH_LEN,
+                                     G_io_apdu_buffer + 1 + i * MESSAGE_SIGNATURE_LEN,
+                                     MESSAGE_SIGNATURE_LEN);
+        PERF_STATS_STOP(PERF_SECTION_SIGNING);
+    }
+    explicit_bzero(&private_key, sizeof(private_key));
+    if (err != CX_OK) {
+        abort_batch();
+        return ERR_SIGNATURE_FAILED;
+    }
+
+    batch_context.count -= count;
+    batch_context.idle_ticks = 0;
+    if (batch_context.count == 0) {
+        init_batch_context();
+    }
+    G_io_apdu_buffer[0] = count;
+    *tx = 1 + count * MESSAGE_SIGNATURE_LEN;
+    return MSG_OK;
+}
+
+uint16_t handle_sign_tx_batch(uint8_t p1,
+                              uint8_t *data_buffer,
+                              uint16_t data_length,
+                              volatile unsigned int *flags,
+                              volatile unsigned int *tx) {
+    switch (p1) {
+        case P1_FIRST:
+            init_batch_context();
+            init_tx_context();
+            checkpoint_spending();
+            batch_context.state = BATCH_RECEIVING;
+            app_state = APP_STATE_SIGNING_BATCH;
+            break;
+        case P1_BATCH_NEXT_TX:
+            if (batch_context.state != BATCH_RECEIVING || app_state != APP_STATE_SIGNING_BATCH ||
+                tx_hash_context.status != JSON_IDLE) {
+                return ERR_INVALID_MESSAGE;
+            }
+            if (batch_context.count >= MAX_BATCH_TX_COUNT) {
+                return ERR_MESSAGE_TOO_LONG;
+            }
+            init_tx_context();
+            app_state = APP_STATE_SIGNING_BATCH;
+            break;
+        case P1_MORE:
+            if (batch_context.state != BATCH_RECEIVING || app_state != APP_STATE_SIGNING_BATCH ||
+                tx_hash_context.status == JSON_IDLE) {
+                return ERR_INVALID_MESSAGE;
+            }
+            break;
+        case P1_BATCH_REVIEW:
+            return review_batch(flags);
+        case P1_BATCH_SIGN:
+            return sign_batch_txs(data_buffer, data_length, tx);
+        default:
+            return ERR_INVALID_P1;
+    }
+
+    PERF_STATS_START(PERF_SECTION_HASHING);
+    int err = cx_hash_no_throw((cx_hash_t *) &sha3_context, 0, data_buffer, data_length, NULL, 0);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
+    if (err != CX_OK) {
+        abort_batch();
+        return err;
+    }
+
+    PERF_STATS_START(PERF_SECTION_PARSING);
+    uint16_t sw = parse_data(data_buffer, data_length);
+    PERF_STATS_STOP(PERF_SECTION_PARSING);
+    if (sw == MSG_OK && tx_hash_context.status == JSON_IDLE) {
+        sw = add_tx_to_batch(tx);
+    }
+    if (sw != MSG_OK) {
+        abort_batch();
+    }
+    return sw;
+}
@@ -0,0 +1,41 @@
+#ifndef _SIGN_TX_BATCH_H_
+#define _SIGN_TX_BATCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "os.h"
+
+// P1 of INS_SIGN_TX_BATCH, P1_FIRST and P1_MORE keep their meaning for the chunks of a transaction
+#define P1_BATCH_NEXT_TX 0x01  // first chunk of each transaction after the first one
+#define P1_BATCH_REVIEW  0x02  // no more transactions, review the batch
+#define P1_BATCH_SIGN    0x03  // signatures of the next transactions, from the last one
+
+#define MAX_BATCH_TX_COUNT 1000
+// receivers told apart on the review screen, more are shown as "more than ..."
+#if defined(TARGET_NANOS)
+#define MAX_BATCH_RECEIVERS 8
+#else
+#define MAX_BATCH_RECEIVERS 16
+#endif
+
+// size of the ticket returned for each transaction and sent back to get its signature
+#define BATCH_TICKET_LEN 64
+// signatures returned by a single P1_BATCH_SIGN, after a count byte
+#define MAX_BATCH_SIGN_COUNT ((sizeof(G_io_apdu_buffer) - 2 - 1) / MESSAGE_SIGNATURE_LEN)
+
+// an approved batch left unsigned is dropped after this many ticker events (one every 100ms)
+#ifndef BATCH_TIMEOUT_TICKS
+#define BATCH_TIMEOUT_TICKS 300
+#endif
+
+void init_batch_context(void);
+void batch_context_tick(void);
+uint16_t handle_sign_tx_batch(uint8_t p1,
+                              uint8_t *data_buffer,
+                              uint16_t data_length,
+                              volatile unsigned int *flags,
+                              volatile unsigned int *tx);
+
+#endif
@@ -2,7 +2,9 @@
 #include "get_private_key.h"
 #include "globals.h"
 #include "parse_tx.h"
+#include "perf_stats.h"
 #include "provide_ESDT_info.h"
+#include "signing_policy.h"
 #include "utils.h"
 #include "ux.h"
 #include <uint256.h>
@@ -15,6 +17,8 @@
 tx_hash_context_t tx_hash_context;
 tx_context_t tx_context;
 bool should_display_esdt_flow;
+// set while a queued transaction is on screen, see display_tx_review
+static tx_approved_callback_t tx_approved_callback;
 
 static uint8_t set_result_signature() {
     uint8_t tx = 0;
@@ -22,10 +26,15 @@ static uint8_t set_result_signature() {
     G_io_apdu_buffer[tx++] = sig_size;
     memmove(G_io_apdu_buffer + tx, tx_context.signature, sig_size);
     tx += sig_size;
+    if (tx_hash_context.return_hash) {
+        G_io_apdu_buffer[tx++] = HASH_LEN;
+        memmove(G_io_apdu_buffer + tx, tx_hash_context.hash, HASH_LEN);
+        tx += HASH_LEN;
+    }
     return tx;
 }
 
-static bool sign_tx_hash(uint8_t *data_buffer) {
+static bool sign_tx_hash(void) {
     cx_ecfp_private_key_t private_key;
     bool success = true;
     int ret_code = 0;
@@ -34,21 +43,14 @@ static bool sign_tx_hash(uint8_t *data_buffer) {
         return false;
     }
 
-    ret_code = cx_hash_no_throw((cx_hash_t *) &sha3_context,
-                                CX_LAST,
-                                data_buffer,
-                                0,
-                                tx_hash_context.hash,
-                                32);
-    if (ret_code != CX_OK) {
-        success = false;
-    }
+    PERF_STATS_START(PERF_SECTION_SIGNING);
     ret_code = cx_eddsa_sign_no_throw(&private_key,
                                       CX_SHA512,
                                       tx_hash_context.hash,
                                       32,
                                       tx_context.signature,
                                       64);
+    PERF_STATS_STOP(PERF_SECTION_SIGNING);
     if (ret_code != 0) {
         success = false;
     }
@@ -58,37 +60,26 @@ static bool sign_tx_hash(uint8_t *data_buffer) {
 }
 
 static bool is_esdt_transfer() {
-    bool identifier_len_valid = esdt_info.identifier_len > 0;
-    bool has_data = strlen(tx_context.data) > 0;
-    bool has_esdt_transfer_prefix = false;
-    bool has_registered_esdt_identifier = false;
-    bool next_char_after_identifier_is_at_separator = false;
-    bool same_chainid = false;
-
-    if (!esdt_info.valid) {
+    const char *decoded = tx_context.data + DATA_SIZE_LEN - 1;
+
+    if (!esdt_info.valid || esdt_info.identifier_len == 0) {
         return false;
     }
 
-    if (has_data && identifier_len_valid) {
-        has_esdt_transfer_prefix = strncmp(tx_context.data + DATA_SIZE_LEN - 1,
-                                           ESDT_TRANSFER_PREFIX,
-                                           ESDT_TRANSFER_PREFIX_LENGTH) == 0;
-        has_registered_esdt_identifier =
-            strncmp(tx_context.data + DATA_SIZE_LEN - 1 + ESDT_TRANSFER_PREFIX_LENGTH,
-                    esdt_info.identifier,
-                    esdt_info.identifier_len) == 0;
-
-        size_t identifier_end_position =
-            DATA_SIZE_LEN - 1 + ESDT_TRANSFER_PREFIX_LENGTH + esdt_info.identifier_len;
-        next_char_after_identifier_is_at_separator =
-            (strlen(tx_context.data) > identifier_end_position) &&
-            (tx_context.data[identifier_end_position] == '@');
-
-        same_chainid = strncmp(tx_context.chain_id, esdt_info.chain_id, MAX_CHAINID_LEN) == 0;
+    // "ESDTTransfer@<identifier>@...": the separators were recorded when the
+    // data field was decoded, the first one being the one of the prefix
+    if (tx_context.data_args_count < 2 ||
+        strncmp(decoded, ESDT_TRANSFER_PREFIX, ESDT_TRANSFER_PREFIX_LENGTH) != 0) {
+        return false;
+    }
+    if (tx_context.data_args[1] != ESDT_TRANSFER_PREFIX_LENGTH + esdt_info.identifier_len ||
+        memcmp(decoded + ESDT_TRANSFER_PREFIX_LENGTH,
+               esdt_info.identifier,
+               esdt_info.identifier_len) != 0) {
+        return false;
     }
 
-    return has_esdt_transfer_prefix && has_registered_esdt_identifier &&
-           next_char_after_identifier_is_at_separator && same_chainid;
+    return strncmp(tx_context.chain_id, esdt_info.chain_id, MAX_CHAINID_LEN) == 0;
 }
 
 #if defined(TARGET_STAX)
@@ -106,6 +97,10 @@ static const nbgl_pageInfoLongPress_t review_final_long_press = {
 
 static void review_final_callback(bool confirmed) {
     if (confirmed) {
+        if (tx_approved_callback != NULL) {
+            tx_approved_callback();
+            return;
+        }
         int tx = set_result_signature();
         send_response(tx, true, false);
         nbgl_useCaseStatus("TRANSACTION\nSIGNED", true, ui_idle);
@@ -163,7 +158,14 @@ static void start_review(void) {
 }
 
 static void ui_sign_tx_hash_nbgl(void) {
-    if (should_display_esdt_flow) {
+    if (tx_hash_context.hash_only) {
+        nbgl_useCaseReviewStart(&C_icon_multiversx_logo_64x64,
+                                "Blind signing:\nreview transaction on\n" APPNAME " network",
+                                "The transaction hash\ncannot be verified",
+                                "Reject transaction",
+                                start_review,
+                                nbgl_reject_transaction_choice);
+    } else if (should_display_esdt_flow) {
         nbgl_useCaseReviewStart(&C_icon_multiversx_logo_64x64,
                                 "Review transaction to\nsend ESDT on\n" APPNAME " network",
                                 "",
@@ -185,6 +187,14 @@ static void ui_sign_tx_hash_nbgl(void) {
 const ux_flow_step_t *tx_flow[TX_SIGN_FLOW_SIZE];
 const ux_flow_step_t *esdt_flow[ESDT_TRANSFER_FLOW_SIZE];
 
+static void approve_tx(void) {
+    if (tx_approved_callback != NULL) {
+        tx_approved_callback();
+        return;
+    }
+    send_response(set_result_signature(), true, true);
+}
+
 // UI for confirming the ESDT transfer on screen
 UX_STEP_NOCB(ux_transfer_esdt_flow_24_step,
              bnnn_paging,
@@ -230,7 +240,7 @@ UX_STEP_NOCB(ux_transfer_esdt_flow_28_step,
              });
 UX_STEP_VALID(ux_transfer_esdt_flow_29_step,
               pb,
-              send_response(set_result_signature(), true, true),
+              approve_tx(),
               {
                   &C_icon_validate_14,
                   "Confirm transfer",
@@ -243,6 +253,15 @@ UX_STEP_VALID(ux_transfer_esdt_flow_30_step,
                   "Reject",
               });
 
+// UI for warning that the transaction hash was provided by the host
+UX_STEP_NOCB(ux_sign_tx_hash_flow_26_step,
+             pnn,
+             {
+                 &C_icon_warning,
+                 "Blind",
+                 "signing",
+             });
+
 // UI for confirming the tx details of the transaction on screen
 UX_STEP_NOCB(ux_sign_tx_hash_flow_17_step,
              bnnn_paging,
@@ -288,7 +307,7 @@ UX_STEP_NOCB(ux_sign_tx_hash_flow_21_step,
              });
 UX_STEP_VALID(ux_sign_tx_hash_flow_22_step,
               pb,
-              send_response(set_result_signature(), true, true),
+              approve_tx(),
               {
                   &C_icon_validate_14,
                   "Sign transaction",
@@ -304,6 +323,9 @@ UX_STEP_VALID(ux_sign_tx_hash_flow_23_step,
 static void display_tx_sign_flow() {
     uint8_t step = 0;
 
+    if (tx_hash_context.hash_only) {
+        tx_flow[step++] = &ux_sign_tx_hash_flow_26_step;
+    }
     tx_flow[step++] = &ux_sign_tx_hash_flow_17_step;
     tx_flow[step++] = &ux_sign_tx_hash_flow_18_step;
     tx_flow[step++] = &ux_sign_tx_hash_flow_19_step;
@@ -327,6 +349,9 @@ static void display_tx_sign_flow() {
 static void display_esdt_flow() {
     uint8_t step = 0;
 
+    if (tx_hash_context.hash_only) {
+        esdt_flow[step++] = &ux_sign_tx_hash_flow_26_step;
+    }
     esdt_flow[step++] = &ux_transfer_esdt_flow_24_step;
     esdt_flow[step++] = &ux_transfer_esdt_flow_25_step;
     esdt_flow[step++] = &ux_transfer_esdt_flow_26_step;
@@ -349,9 +374,14 @@ static void display_esdt_flow() {
 
 void init_tx_context() {
     tx_context.amount[0] = 0;
-    tx_context.data[0] = 0;
+    clear128(&tx_context.value);
+    // nothing decoded from the data field of a previous transaction may be shown again
+    memset(tx_context.data, 0, sizeof(tx_context.data));
+    tx_context.data_args_count = 0;
     tx_context.data_size = 0;
     tx_context.fee[0] = 0;
+    tx_context.nonce = 0;
+    tx_context.nonce_valid = false;
     tx_context.gas_limit = 0;
     tx_context.gas_price = 0;
     tx_context.receiver[0] = 0;
@@ -361,6 +391,13 @@ void init_tx_context() {
     tx_context.guardian[0] = 0;
     tx_context.relayer[0] = 0;
     tx_hash_context.status = JSON_IDLE;
+    tx_hash_context.current_field_id = FIELD_UNKNOWN;
+    tx_hash_context.data_field_size = 0;
+    tx_hash_context.data_carry = 0;
+    tx_hash_context.data_carry_len = 0;
+    tx_hash_context.data_carry_padding = 0;
+    tx_hash_context.hash_only = false;
+    tx_hash_context.return_hash = false;
     int err = cx_keccak_init_no_throw(&sha3_context, SHA3_KECCAK_BITS);
     if (err != CX_OK) {
         THROW(err);
@@ -369,65 +406,170 @@ void init_tx_context() {
     app_state = APP_STATE_IDLE;
 }
 
-void handle_sign_tx_hash(uint8_t p1,
-                         uint8_t *data_buffer,
-                         uint16_t data_length,
-                         volatile unsigned int *flags) {
+uint16_t prepare_tx_review(void) {
+    should_display_esdt_flow = false;
+    if (is_esdt_transfer()) {
+        uint16_t res;
+        PERF_STATS_START(PERF_SECTION_PARSING);
+        res = parse_esdt_data();
+        PERF_STATS_STOP(PERF_SECTION_PARSING);
+        if (res != MSG_OK) {
+            return res;
+        }
+        should_display_esdt_flow = true;
+    }
+    return MSG_OK;
+}
+
+void display_tx_review(tx_approved_callback_t on_approved) {
+    tx_approved_callback = on_approved;
+#if defined(TARGET_STAX)
+    ui_sign_tx_hash_nbgl();
+#else
+    if (should_display_esdt_flow) {
+        display_esdt_flow();
+    } else {
+        display_tx_sign_flow();
+    }
+#endif
+}
+
+// review_tx signs the hash of the fully parsed transaction and starts the review flow. The
+// signature is only sent back if the user approves the transaction
+static uint16_t review_tx(volatile unsigned int *flags) {
+    if (!sign_tx_hash()) {
+        init_tx_context();
+        return ERR_SIGNATURE_FAILED;
+    }
+
+    uint16_t sw = prepare_tx_review();
+    if (sw != MSG_OK) {
+        return sw;
+    }
+
+    app_state = APP_STATE_IDLE;
+    display_tx_review(NULL);
+
+    *flags |= IO_ASYNCH_REPLY;
+    return MSG_OK;
+}
+
+uint16_t handle_sign_tx_hash(uint8_t p1,
+                             uint8_t p2,
+                             uint8_t *data_buffer,
+                             uint16_t data_length,
+                             volatile unsigned int *flags,
+                             volatile unsigned int *tx) {
     if (p1 == P1_FIRST) {
+        if (p2 != P2_SIGNATURE_ONLY && p2 != P2_RETURN_HASH) {
+            return ERR_INVALID_ARGUMENTS;
+        }
         init_tx_context();
         app_state = APP_STATE_SIGNING_TX;
+        tx_hash_context.return_hash = (p2 == P2_RETURN_HASH);
     } else {
         if (p1 != P1_MORE) {
-            THROW(ERR_INVALID_P1);
+            return ERR_INVALID_P1;
         }
-        if (app_state != APP_STATE_SIGNING_TX) {
-            THROW(ERR_INVALID_MESSAGE);
+        if (app_state != APP_STATE_SIGNING_TX || tx_hash_context.hash_only) {
+            return ERR_INVALID_MESSAGE;
         }
     }
 
+    PERF_STATS_START(PERF_SECTION_HASHING);
     int err = cx_hash_no_throw((cx_hash_t *) &sha3_context, 0, data_buffer, data_length, NULL, 0);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
     if (err != CX_OK) {
         init_tx_context();
-        THROW(err);
+        return err;
     }
 
+    PERF_STATS_START(PERF_SECTION_PARSING);
     uint16_t parse_err = parse_data(data_buffer, data_length);
+    PERF_STATS_STOP(PERF_SECTION_PARSING);
     if (parse_err != MSG_OK) {
         init_tx_context();
-        THROW(parse_err);
+        return parse_err;
     }
 
     if (tx_hash_context.status != JSON_IDLE) {
-        THROW(MSG_OK);
+        return MSG_OK;
     }
 
-    // sign the hash
-    if (!sign_tx_hash(data_buffer)) {
+    PERF_STATS_START(PERF_SECTION_HASHING);
+    err = cx_hash_no_throw((cx_hash_t *) &sha3_context,
+                           CX_LAST,
+                           data_buffer,
+                           0,
+                           tx_hash_context.hash,
+                           32);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
+    if (err != CX_OK) {
         init_tx_context();
-        THROW(ERR_SIGNATURE_FAILED);
+        return ERR_SIGNATURE_FAILED;
     }
 
-    should_display_esdt_flow = false;
-    if (is_esdt_transfer()) {
-        uint16_t res;
-        res = parse_esdt_data();
-        if (res != MSG_OK) {
-            THROW(res);
+    // the transactions allowed by the policy the user enabled are signed without review
+    if (policy_allows_tx()) {
+        if (!sign_tx_hash()) {
+            init_tx_context();
+            return ERR_SIGNATURE_FAILED;
         }
-        should_display_esdt_flow = true;
+        policy_record_tx();
+        app_state = APP_STATE_IDLE;
+        *tx = set_result_signature();
+        return MSG_OK;
     }
 
-    app_state = APP_STATE_IDLE;
+    return review_tx(flags);
+}
 
-#if defined(TARGET_STAX)
-    ui_sign_tx_hash_nbgl();
-#else
-    if (should_display_esdt_flow) {
-        display_esdt_flow();
+uint16_t handle_sign_tx_hash_only(uint8_t p1,
+                                  uint8_t *data_buffer,
+                                  uint16_t data_length,
+                                  volatile unsigned int *flags) {
+    /*
+       data buffer structure should be:
+       <transaction hash> + <json with the fields to be displayed>
+               ^                           ^
+           32 bytes          can come in multiple bulks
+
+       the transaction hash is computed by the host and cannot be verified by
+       the device, so this mode has to be enabled from the settings menu
+    */
+    if (p1 == P1_FIRST) {
+        if (N_storage.setting_hash_signing == HASH_SIGNING_DISABLED) {
+            return ERR_HASH_SIGNING_DISABLED;
+        }
+        if (data_length < HASH_LEN) {
+            return ERR_INVALID_MESSAGE;
+        }
+        init_tx_context();
+        app_state = APP_STATE_SIGNING_TX;
+        tx_hash_context.hash_only = true;
+        memmove(tx_hash_context.hash, data_buffer, HASH_LEN);
+        data_buffer += HASH_LEN;
+        data_length -= HASH_LEN;
     } else {
-        display_tx_sign_flow();
+        if (p1 != P1_MORE) {
+            return ERR_INVALID_P1;
+        }
+        if (app_state != APP_STATE_SIGNING_TX || !tx_hash_context.hash_only) {
+            return ERR_INVALID_MESSAGE;
+        }
     }
-#endif
 
-    *flags |= IO_ASYNCH_REPLY;
+    PERF_STATS_START(PERF_SECTION_PARSING);
+    uint16_t parse_err = parse_data(data_buffer, data_length);
+    PERF_STATS_STOP(PERF_SECTION_PARSING);
+    if (parse_err != MSG_OK) {
+        init_tx_context();
+        return parse_err;
+    }
+
+    if (tx_hash_context.status != JSON_IDLE) {
+        return MSG_OK;
+    }
+
+    return review_tx(flags);
 }
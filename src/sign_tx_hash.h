@@ -1,6 +1,7 @@
 #ifndef _SIGN_TX_HASH_H_
 #define _SIGN_TX_HASH_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define NONCE_FIELD             "nonce"
@@ -18,9 +19,34 @@
 #define GUARDIAN_ADDR_FIELD     "guardian"
 #define RELAYER_FIELD           "relayer"
 
+// P2 of the first chunk: append the transaction hash to the signature
+#define P2_SIGNATURE_ONLY 0x00
+#define P2_RETURN_HASH    0x01
+
 #define MAX_FIELD_LEN 16
+// the data field is decoded on the fly and never stored encoded, so this only
+// has to hold the other values, the usernames being the longest
 #define MAX_VALUE_LEN 128UL
 
+typedef enum tx_field_e {
+    FIELD_UNKNOWN,
+    FIELD_NONCE,
+    FIELD_VALUE,
+    FIELD_RECEIVER,
+    FIELD_SENDER,
+    FIELD_GASPRICE,
+    FIELD_GASLIMIT,
+    FIELD_DATA,
+    FIELD_CHAINID,
+    FIELD_VERSION,
+    FIELD_OPTIONS,
+    FIELD_SENDER_USERNAME,
+    FIELD_RECEIVER_USERNAME,
+    FIELD_GUARDIAN,
+    FIELD_RELAYER,
+    FIELD_COUNT
+} tx_field_e;
+
 typedef enum parser_status_e {
     JSON_IDLE,
     JSON_EXPECTING_FIELD,
@@ -37,15 +63,39 @@ typedef struct {
     parser_status_e status;
     char current_field[MAX_FIELD_LEN + 1];
     uint8_t current_field_len;
+    tx_field_e current_field_id;
     char current_value[MAX_VALUE_LEN + 1];
     uint32_t current_value_len;
     uint32_t data_field_size;
+    // base64 decoder state of the data field, which can span several chunks
+    uint32_t data_carry;         // 6-bit groups of the incomplete quad
+    uint8_t data_carry_len;      // characters of the incomplete quad, 0-3
+    uint8_t data_carry_padding;  // '=' characters of the incomplete quad
+    bool hash_only;
+    bool return_hash;
 } tx_hash_context_t;
 
+// called instead of sending the signature back when the user approves a transaction
+typedef void (*tx_approved_callback_t)(void);
+
+extern bool should_display_esdt_flow;
+
 void init_tx_context(void);
-void handle_sign_tx_hash(uint8_t p1,
-                         uint8_t *data_buffer,
-                         uint16_t data_length,
-                         volatile unsigned int *flags);
+// prepare_tx_review picks the review flow of the fully parsed transaction, ESDT transfers having
+// their data parsed further
+uint16_t prepare_tx_review(void);
+// display_tx_review shows the review of tx_context, on_approved being NULL for the transactions
+// whose signature is sent back as soon as they are approved
+void display_tx_review(tx_approved_callback_t on_approved);
+uint16_t handle_sign_tx_hash(uint8_t p1,
+                             uint8_t p2,
+                             uint8_t *data_buffer,
+                             uint16_t data_length,
+                             volatile unsigned int *flags,
+                             volatile unsigned int *tx);
+uint16_t handle_sign_tx_hash_only(uint8_t p1,
+                                  uint8_t *data_buffer,
+                                  uint16_t data_length,
+                                  volatile unsigned int *flags);
 
 #endif
@@ -0,0 +1,244 @@
+#include "sign_tx_queue.h"
+
+#if !defined(TARGET_NANOS)
+
+#include "buffering.h"
+#include "get_private_key.h"
+#include "globals.h"
+#include "parse_tx.h"
+#include "perf_stats.h"
+#include "provide_ESDT_info.h"
+#include "utils.h"
+#include "ux.h"
+#include "menu.h"
+
+#ifdef HAVE_NBGL
+#include "nbgl_use_case.h"
+#endif
+
+/*
+   A queue lets the host upload several transactions before the first review, so that the reviews
+   follow each other without waiting for the transfer and the parsing of the next transaction:
+
+   1. the transactions are streamed like with INS_SIGN_TX_HASH: the first chunk of the first one
+      with P1_FIRST, the first chunk of the next ones with P1_QUEUE_NEXT_TX, the other chunks with
+      P1_MORE. Each one is hashed and parsed on arrival, then queued with what its review shows
+   2. P1_QUEUE_REVIEW shows the reviews back to back and is answered once the last one is approved:
+      <count> + count x <signature>
+      1 byte       64 bytes
+      Rejecting any transaction rejects the whole queue
+
+   The upload cannot go on during the reviews: the exchange is half duplex and P1_QUEUE_REVIEW is
+   only answered at the end, while the transaction on screen is displayed from tx_context, which
+   parsing the next one would overwrite.
+
+   The queue is kept in RAM with the buffering of zxlib. It needs about 2.7 KB, which Nano S
+   cannot spare, so the command is left out there rather than writing the queue to flash.
+*/
+
+// a queued transaction: <hash> + <tx_context> + <esdt_info> + <ESDT flow>
+#define QUEUED_TX_SIZE (HASH_LEN + sizeof(tx_context_t) + sizeof(esdt_info_t) + 1)
+
+typedef enum { QUEUE_IDLE, QUEUE_RECEIVING, QUEUE_REVIEWING } queue_state_t;
+
+typedef struct {
+    queue_state_t state;
+    uint8_t count;
+    uint8_t approved;
+    uint32_t account;
+    uint32_t address_index;
+} queue_context_t;
+
+static queue_context_t queue_context;
+
+static uint8_t ram_queue[MAX_TX_QUEUE_COUNT * QUEUED_TX_SIZE];
+
+static void append_ram(buffer_state_t *buffer, uint8_t *data, int size) {
+    memmove(buffer->data + buffer->pos, data, size);
+}
+
+void init_queue_context(void) {
+    memset(&queue_context, 0, sizeof(queue_context));
+    buffering_init(ram_queue, sizeof(ram_queue), append_ram, NULL, 0, NULL);
+}
+
+static void abort_queue(void) {
+    init_queue_context();
+    init_tx_context();
+}
+
+static const uint8_t *queued_tx(uint8_t index) {
+    return buffering_get_buffer()->data + index * QUEUED_TX_SIZE;
+}
+
+// queue_tx appends the fully parsed transaction to the queue
+static uint16_t queue_tx(void) {
+    PERF_STATS_START(PERF_SECTION_HASHING);
+    int err = cx_hash_no_throw((cx_hash_t *) &sha3_context,
+                               CX_LAST,
+                               NULL,
+                               0,
+                               tx_hash_context.hash,
+                               HASH_LEN);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
+    if (err != CX_OK) {
+        return ERR_SIGNATURE_FAILED;
+    }
+
+    uint16_t sw = prepare_tx_review();
+    if (sw != MSG_OK) {
+        return sw;
+    }
+
+    uint8_t esdt_flow = should_display_esdt_flow;
+    if (buffering_append(tx_hash_context.hash, HASH_LEN) != HASH_LEN ||
+        buffering_append((uint8_t *) &tx_context, sizeof(tx_context)) != sizeof(tx_context) ||
+        buffering_append((uint8_t *) &esdt_info, sizeof(esdt_info)) != sizeof(esdt_info) ||
+        buffering_append(&esdt_flow, 1) != 1) {
+        return ERR_MESSAGE_TOO_LONG;
+    }
+    queue_context.count++;
+    return MSG_OK;
+}
+
+// sign_queue writes the count and the signatures of the queued transactions to the IO buffer
+static bool sign_queue(uint16_t *tx) {
+    cx_ecfp_private_key_t private_key;
+    bool success = true;
+
+    if (!get_private_key(queue_context.account, queue_context.address_index, &private_key)) {
+        return false;
+    }
+
+    G_io_apdu_buffer[0] = queue_context.count;
+    *tx = 1;
+    for (uint8_t i = 0; i < queue_context.count && success; i++) {
+        PERF_STATS_START(PERF_SECTION_SIGNING);
+        int err = cx_eddsa_sign_no_throw(&private_key,
+                                         CX_SHA512,
+                                         queued_tx(i),
+                                         HASH_LEN,
+                                         G_io_apdu_buffer + *tx,
+                                         MESSAGE_SIGNATURE_LEN);
+        PERF_STATS_STOP(PERF_SECTION_SIGNING);
+        success = err == CX_OK;
+        *tx += MESSAGE_SIGNATURE_LEN;
+    }
+    explicit_bzero(&private_key, sizeof(private_key));
+
+    return success;
+}
+
+static void show_queued_tx(void);
+
+static void queued_tx_approved(void) {
+    uint16_t tx = 0;
+
+    if (++queue_context.approved < queue_context.count) {
+        show_queued_tx();
+        return;
+    }
+
+    bool success = sign_queue(&tx);
+    abort_queue();
+    if (!success) {
+        // the review flow is over, only the status word is sent back
+        send_status(0, ERR_SIGNATURE_FAILED, true);
+        return;
+    }
+#if defined(TARGET_STAX)
+    send_response(tx, true, false);
+    nbgl_useCaseStatus("TRANSACTIONS\nSIGNED", true, ui_idle);
+#else
+    send_response(tx, true, true);
+#endif
+}
+
+// show_queued_tx restores the next transaction to approve and starts its review
+static void show_queued_tx(void) {
+    const uint8_t *entry = queued_tx(queue_context.approved);
+
+    memmove(tx_hash_context.hash, entry, HASH_LEN);
+    entry += HASH_LEN;
+    memmove(&tx_context, entry, sizeof(tx_context));
+    entry += sizeof(tx_context);
+    memmove(&esdt_info, entry, sizeof(esdt_info));
+    entry += sizeof(esdt_info);
+    should_display_esdt_flow = entry[0];
+
+    display_tx_review(queued_tx_approved);
+}
+
+static uint16_t review_queue(volatile unsigned int *flags) {
+    if (queue_context.state != QUEUE_RECEIVING || app_state != APP_STATE_SIGNING_QUEUE ||
+        tx_hash_context.status != JSON_IDLE || queue_context.count == 0) {
+        return ERR_INVALID_MESSAGE;
+    }
+
+    // the transactions are signed with the account selected when they were reviewed
+    queue_context.account = bip32_account;
+    queue_context.address_index = bip32_address_index;
+    queue_context.state = QUEUE_REVIEWING;
+    queue_context.approved = 0;
+    app_state = APP_STATE_IDLE;
+
+    show_queued_tx();
+    *flags |= IO_ASYNCH_REPLY;
+    return MSG_OK;
+}
+
+uint16_t handle_sign_tx_queue(uint8_t p1,
+                              uint8_t *data_buffer,
+                              uint16_t data_length,
+                              volatile unsigned int *flags) {
+    switch (p1) {
+        case P1_FIRST:
+            init_queue_context();
+            init_tx_context();
+            queue_context.state = QUEUE_RECEIVING;
+            app_state = APP_STATE_SIGNING_QUEUE;
+            break;
+        case P1_QUEUE_NEXT_TX:
+            if (queue_context.state != QUEUE_RECEIVING || app_state != APP_STATE_SIGNING_QUEUE ||
+                tx_hash_context.status != JSON_IDLE) {
+                return ERR_INVALID_MESSAGE;
+            }
+            if (queue_context.count >= MAX_TX_QUEUE_COUNT) {
+                return ERR_MESSAGE_TOO_LONG;
+            }
+            init_tx_context();
+            app_state = APP_STATE_SIGNING_QUEUE;
+            break;
+        case P1_MORE:
+            if (queue_context.state != QUEUE_RECEIVING || app_state != APP_STATE_SIGNING_QUEUE ||
+                tx_hash_context.status == JSON_IDLE) {
+                return ERR_INVALID_MESSAGE;
+            }
+            break;
+        case P1_QUEUE_REVIEW:
+            return review_queue(flags);
+        default:
+            return ERR_INVALID_P1;
+    }
+
+    PERF_STATS_START(PERF_SECTION_HASHING);
+    int err = cx_hash_no_throw((cx_hash_t *) &sha3_context, 0, data_buffer, data_length, NULL, 0);
+    PERF_STATS_STOP(PERF_SECTION_HASHING);
+    if (err != CX_OK) {
+        abort_queue();
+        return err;
+    }
+
+    PERF_STATS_START(PERF_SECTION_PARSING);
+    uint16_t sw = parse_data(data_buffer, data_length);
+    PERF_STATS_STOP(PERF_SECTION_PARSING);
+    if (sw == MSG_OK && tx_hash_context.status == JSON_IDLE) {
+        sw = queue_tx();
+    }
+    if (sw != MSG_OK) {
+        abort_queue();
+    }
+    return sw;
+}
+
+#endif  // !TARGET_NANOS
@@ -0,0 +1,28 @@
+#ifndef _SIGN_TX_QUEUE_H_
+#define _SIGN_TX_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "os.h"
+
+// P1 of INS_SIGN_TX_QUEUE, P1_FIRST and P1_MORE keep their meaning for the chunks of a transaction
+#define P1_QUEUE_NEXT_TX 0x01  // first chunk of each transaction after the first one
+#define P1_QUEUE_REVIEW  0x02  // no more transactions, review them one after the other
+
+#if defined(TARGET_NANOS)
+// Nano S has no RAM to spare for the queue, INS_SIGN_TX_QUEUE is not available there
+#define MAX_TX_QUEUE_COUNT 0
+#else
+// the signatures of the whole queue are sent back in a single response, after a count byte
+#define MAX_TX_QUEUE_COUNT ((sizeof(G_io_apdu_buffer) - 2 - 1) / MESSAGE_SIGNATURE_LEN)
+#endif
+
+void init_queue_context(void);
+uint16_t handle_sign_tx_queue(uint8_t p1,
+                              uint8_t *data_buffer,
+                              uint16_t data_length,
+                              volatile unsigned int *flags);
+
+#endif
@@ -0,0 +1,621 @@
+#include "signing_policy.h"
+#include "globals.h"
+#include "address_helpers.h"
+#include "parse_tx.h"
+#include "receiver_allowlist.h"
+#include "utils.h"
+#include "ux.h"
+#include "menu.h"
+
+#ifdef HAVE_NBGL
+#include "nbgl_use_case.h"
+#endif
+
+/*
+   A signing policy lets the host get the signature of the transactions it describes without a
+   review. It is written to flash as it is received, disabled, and only enabled once the user
+   approved it on the device:
+
+   1. P1_POLICY_BEGIN clears the policy and sets its chain ID and the highest value plus fee of a
+      transaction
+   2. P1_POLICY_ADD_RECEIVER and P1_POLICY_ADD_FUNCTION add the allowed receivers, see
+      receiver_allowlist.c, and function names
+   3. P1_POLICY_CONFIRM shows the policy and is answered once the user approved or rejected it.
+      Every receiver is shown as its address, formatted from flash as the user pages through them
+
+   A transaction is allowed when the policy is enabled, it is on the chain ID of the policy, its
+   value plus fee do not exceed the limit, it goes to one of the receivers, it has no guardian nor
+   relayer and its data is empty or calls one of the functions: the data is the function name,
+   alone or followed by '@' and the arguments. Any other data, including the built-in functions
+   moving the tokens of the account that the user did not approve by name, gets the review, and
+   so does blind signing. The limit only bounds EGLD. With spending limits, the transactions
+   signed without review and the transactions of a batch must also fit in the window of their
+   nonce, see spending_limits.c.
+*/
+
+// receivers formatted at the same time. On Stax, NBGL gets the pairs of a page one by one and
+// keeps their pointers until the page is drawn: a page shows at most 4 consecutive pairs, so the
+// receivers of a page never share a slot. Nano only needs one for the step paging through them
+#if defined(TARGET_STAX)
+#define MAX_FORMATTED_RECEIVERS 4
+#else
+#define MAX_FORMATTED_RECEIVERS 1
+#endif
+
+typedef enum { POLICY_IDLE, POLICY_RECEIVING, POLICY_REVIEWING } policy_state_t;
+
+typedef struct {
+    policy_state_t state;
+    char max_amount[MAX_AMOUNT_LEN + PRETTY_SIZE];
+    char window[MAX_UINT32_LEN + 1];
+    char window_max_amount[MAX_AMOUNT_LEN + PRETTY_SIZE];
+    char window_max_count[MAX_UINT32_LEN + 1];
+    char receivers_count[MAX_UINT32_LEN + 1];
+    char receiver_titles[MAX_FORMATTED_RECEIVERS][sizeof("Receiver ") + 2 * MAX_UINT32_LEN];
+    char receivers[MAX_FORMATTED_RECEIVERS][BECH32_ADDRESS_LEN + 1];
+#if !defined(TARGET_STAX)
+    uint16_t receiver_index;  // receiver on screen
+    bool paging_receivers;    // the receiver step is on screen or being left
+#endif
+} policy_context_t;
+
+static policy_context_t policy_context;
+
+static const signing_policy_t *policy(void) {
+    return (const signing_policy_t *) &N_policy;
+}
+
+bool policy_enabled(void) {
+    return N_policy.enabled == 1;
+}
+
+// matches_data tells if the data is empty or calls one of the functions of the policy. The
+// names are shorter than the decoded data kept for display, so the character after one is there
+static bool matches_data(const signing_policy_t *allowed) {
+    const char *decoded = tx_context.data + DATA_SIZE_LEN - 1;
+
+    if (tx_context.data_size == 0) {
+        return true;
+    }
+    for (uint8_t i = 0; i < allowed->functions_count; i++) {
+        size_t name_len = strlen(allowed->functions[i]);
+        if (tx_context.data_size < name_len ||
+            memcmp(decoded, allowed->functions[i], name_len) != 0) {
+            continue;
+        }
+        if (tx_context.data_size == name_len || decoded[name_len] == SC_ARGS_SEPARATOR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// tx_total sums up the value and the fee of the transaction, false on overflow
+static bool tx_total(uint128_t *total) {
+    uint128_t fee;
+
+    gas_to_fee(tx_context.gas_limit, tx_context.gas_price, tx_context.data_size, &fee);
+    add128(&tx_context.value, &fee, total);
+    return !gt128(&tx_context.value, total);
+}
+
+bool policy_allows_tx(void) {
+    const signing_policy_t *allowed = policy();
+    uint128_t max_amount;
+    uint128_t total;
+
+    if (!policy_enabled() || tx_hash_context.hash_only) {
+        return false;
+    }
+    if (strncmp(tx_context.chain_id, allowed->chain_id, MAX_CHAINID_LEN) != 0) {
+        return false;
+    }
+    // a guardian or a relayer changes who authorizes or pays for the transaction
+    if (tx_context.guardian[0] != '\0' || tx_context.relayer[0] != '\0') {
+        return false;
+    }
+
+    copy128(&max_amount, (uint128_t *) &allowed->max_amount);
+    if (!tx_total(&total) || gt128(&total, &max_amount)) {
+        return false;
+    }
+    if (!is_allowed_receiver(tx_context.receiver) || !matches_data(allowed)) {
+        return false;
+    }
+
+    if (allowed->limits.window != 0 && !tx_context.nonce_valid) {
+        return false;
+    }
+    return spending_allows_tx(&allowed->limits, tx_context.nonce, &total);
+}
+
+void policy_record_tx(void) {
+    uint128_t total;
+
+    if (tx_total(&total)) {
+        record_spending(&policy()->limits, tx_context.nonce, &total);
+    }
+}
+
+bool policy_count_batch_tx(void) {
+    const spending_limits_t *limits = &policy()->limits;
+    uint128_t total;
+
+    if (!policy_enabled() || limits->window == 0) {
+        return true;
+    }
+    if (!tx_context.nonce_valid || !tx_total(&total) ||
+        !spending_allows_tx(limits, tx_context.nonce, &total)) {
+        return false;
+    }
+    record_spending(limits, tx_context.nonce, &total);
+    return true;
+}
+
+uint16_t handle_get_spending_limits(volatile unsigned int *tx) {
+    return handle_get_spending(&policy()->limits, tx);
+}
+
+static void write_enabled(uint8_t enabled) {
+    nvm_write((void *) &N_policy.enabled, &enabled, sizeof(enabled));
+}
+
+// approve_policy enables the policy on screen, unless the host started another one meanwhile
+static bool approve_policy(void) {
+    if (policy_context.state != POLICY_REVIEWING) {
+        return false;
+    }
+    policy_context.state = POLICY_IDLE;
+    write_enabled(1);
+    return true;
+}
+
+static void reject_policy(void) {
+    policy_context.state = POLICY_IDLE;
+}
+
+// format_receiver writes "Receiver i/n" and the address of receiver i to a slot
+static void format_receiver(uint16_t index, uint8_t slot) {
+    char *title = policy_context.receiver_titles[slot];
+    size_t title_len = sizeof("Receiver ") - 1;
+
+    memmove(title, "Receiver ", title_len);
+    uint32_t_to_char_array(index + 1, title + title_len);
+    title_len += strlen(title + title_len);
+    title[title_len++] = '/';
+    uint32_t_to_char_array(allowed_receivers_count(), title + title_len);
+    get_address_bech32_from_binary(allowed_receiver(index), policy_context.receivers[slot]);
+}
+
+#if defined(TARGET_STAX)
+
+static nbgl_layoutTagValueList_t layout;
+// the pairs before the receivers, then the function names
+static nbgl_layoutTagValue_t pairs_list[6 + MAX_POLICY_FUNCTIONS];
+static nbgl_layoutTagValue_t receiver_pairs[MAX_FORMATTED_RECEIVERS];
+static uint8_t receivers_first_pair;
+
+static const nbgl_pageInfoLongPress_t review_final_long_press = {
+    .text = "Sign matching\ntransactions without\nreview?",
+    .icon = &C_icon_multiversx_logo_64x64,
+    .longPressText = "Hold to enable",
+    .longPressToken = 0,
+    .tuneId = TUNE_TAP_CASUAL,
+};
+
+static void review_final_callback(bool confirmed) {
+    if (confirmed && approve_policy()) {
+        send_response(0, true, false);
+        nbgl_useCaseStatus("POLICY\nENABLED", true, ui_idle);
+    } else {
+        reject_policy();
+        send_response(0, false, false);
+        nbgl_useCaseStatus("Policy\nrejected", false, ui_idle);
+    }
+}
+
+// get_review_pair gives the pairs of the review, the receivers being formatted on demand in the
+// slot of their index modulo MAX_FORMATTED_RECEIVERS
+static nbgl_layoutTagValue_t *get_review_pair(uint8_t index) {
+    uint16_t count = allowed_receivers_count();
+
+    if (index < receivers_first_pair) {
+        return &pairs_list[index];
+    }
+    if (index - receivers_first_pair >= count) {
+        return &pairs_list[index - count];
+    }
+
+    index -= receivers_first_pair;
+    uint8_t slot = index % MAX_FORMATTED_RECEIVERS;
+    format_receiver(index, slot);
+    receiver_pairs[slot].item = policy_context.receiver_titles[slot];
+    receiver_pairs[slot].value = policy_context.receivers[slot];
+    return &receiver_pairs[slot];
+}
+
+static void start_review(void) {
+    const signing_policy_t *allowed = policy();
+    uint8_t step = 0;
+
+    pairs_list[step].item = "Chain ID";
+    pairs_list[step++].value = allowed->chain_id;
+    pairs_list[step].item = "Max amount + fee";
+    pairs_list[step++].value = policy_context.max_amount;
+    if (allowed->limits.window != 0) {
+        pairs_list[step].item = "Window (nonces)";
+        pairs_list[step++].value = policy_context.window;
+        pairs_list[step].item = "Window max amount";
+        pairs_list[step++].value = policy_context.window_max_amount;
+        pairs_list[step].item = "Window max txs";
+        pairs_list[step++].value = policy_context.window_max_count;
+    }
+    pairs_list[step].item = "Receivers";
+    pairs_list[step++].value = policy_context.receivers_count;
+    receivers_first_pair = step;
+    for (uint8_t i = 0; i < allowed->functions_count; i++) {
+        pairs_list[step].item = "Function";
+        pairs_list[step++].value = allowed->functions[i];
+    }
+
+    layout.nbMaxLinesForValue = 0;
+    layout.smallCaseForValue = false;
+    layout.wrapping = true;
+    layout.pairs = NULL;
+    layout.callback = get_review_pair;
+    layout.startIndex = 0;
+    layout.nbPairs = step + allowed_receivers_count();
+
+    nbgl_useCaseStaticReview(&layout,
+                             &review_final_long_press,
+                             "Reject policy",
+                             review_final_callback);
+}
+
+static void reject_policy_choice(void) {
+    review_final_callback(false);
+}
+
+static void ui_set_policy_nbgl(void) {
+    nbgl_useCaseReviewStart(&C_icon_multiversx_logo_64x64,
+                            "Review signing policy",
+                            "Matching transactions\nwill be signed\nwithout review",
+                            "Reject policy",
+                            start_review,
+                            reject_policy_choice);
+}
+
+#else
+
+static const ux_flow_step_t *policy_flow[13 + MAX_POLICY_FUNCTIONS];
+
+static void approve_policy_choice(void) {
+    send_response(0, approve_policy(), true);
+}
+
+static void reject_policy_choice(void) {
+    reject_policy();
+    send_response(0, false, true);
+}
+
+// UI for confirming the signing policy on screen
+UX_STEP_NOCB(ux_set_policy_flow_0_step,
+             pnn,
+             {
+                 &C_icon_warning,
+                 "Sign without",
+                 "review?",
+             });
+UX_STEP_NOCB(ux_set_policy_flow_1_step,
+             bnnn_paging,
+             {
+                 .title = "Chain ID",
+                 .text = N_policy_real.chain_id,
+             });
+UX_STEP_NOCB(ux_set_policy_flow_2_step,
+             bnnn_paging,
+             {
+                 .title = "Max amount + fee",
+                 .text = policy_context.max_amount,
+             });
+UX_STEP_NOCB(ux_set_policy_window_step,
+             bnnn_paging,
+             {
+                 .title = "Window (nonces)",
+                 .text = policy_context.window,
+             });
+UX_STEP_NOCB(ux_set_policy_window_amount_step,
+             bnnn_paging,
+             {
+                 .title = "Window max amount",
+                 .text = policy_context.window_max_amount,
+             });
+UX_STEP_NOCB(ux_set_policy_window_count_step,
+             bnnn_paging,
+             {
+                 .title = "Window max txs",
+                 .text = policy_context.window_max_count,
+             });
+UX_STEP_NOCB(ux_set_policy_receivers_count_step,
+             bnnn_paging,
+             {
+                 .title = "Receivers",
+                 .text = policy_context.receivers_count,
+             });
+// a single step pages through the receivers, the delimiters around it load the next or previous
+// receiver and show the step again until the user goes past the first or the last one
+static void display_receiver(uint16_t index) {
+    policy_context.receiver_index = index;
+    format_receiver(index, 0);
+}
+
+static void receivers_upper_delimiter(void) {
+    if (!policy_context.paging_receivers) {
+        // entering the list from the step before it
+        display_receiver(0);
+        ux_flow_next();
+    } else if (policy_context.receiver_index > 0) {
+        display_receiver(policy_context.receiver_index - 1);
+        ux_flow_next();
+    } else {
+        policy_context.paging_receivers = false;
+        ux_flow_prev();
+    }
+}
+
+static void receivers_lower_delimiter(void) {
+    if (!policy_context.paging_receivers) {
+        // entering the list from the step after it
+        display_receiver(allowed_receivers_count() - 1);
+        ux_flow_prev();
+    } else if (policy_context.receiver_index + 1 < allowed_receivers_count()) {
+        display_receiver(policy_context.receiver_index + 1);
+        ux_flow_prev();
+    } else {
+        policy_context.paging_receivers = false;
+        ux_flow_next();
+    }
+}
+
+UX_STEP_INIT(ux_set_policy_receivers_upper_step, NULL, NULL, { receivers_upper_delimiter(); });
+UX_STEP_NOCB_INIT(ux_set_policy_receiver_step,
+                  bnnn_paging,
+                  policy_context.paging_receivers = true,
+                  {
+                      .title = policy_context.receiver_titles[0],
+                      .text = policy_context.receivers[0],
+                  });
+UX_STEP_INIT(ux_set_policy_receivers_lower_step, NULL, NULL, { receivers_lower_delimiter(); });
+UX_STEP_NOCB(ux_set_policy_function_0_step,
+             bnnn_paging,
+             {
+                 .title = "Function",
+                 .text = N_policy_real.functions[0],
+             });
+UX_STEP_NOCB(ux_set_policy_function_1_step,
+             bnnn_paging,
+             {
+                 .title = "Function",
+                 .text = N_policy_real.functions[1],
+             });
+UX_STEP_NOCB(ux_set_policy_function_2_step,
+             bnnn_paging,
+             {
+                 .title = "Function",
+                 .text = N_policy_real.functions[2],
+             });
+UX_STEP_NOCB(ux_set_policy_function_3_step,
+             bnnn_paging,
+             {
+                 .title = "Function",
+                 .text = N_policy_real.functions[3],
+             });
+UX_STEP_VALID(ux_set_policy_flow_3_step,
+              pb,
+              approve_policy_choice(),
+              {
+                  &C_icon_validate_14,
+                  "Enable policy",
+              });
+UX_STEP_VALID(ux_set_policy_flow_4_step,
+              pb,
+              reject_policy_choice(),
+              {
+                  &C_icon_crossmark,
+                  "Reject",
+              });
+
+static const ux_flow_step_t *const function_steps[MAX_POLICY_FUNCTIONS] = {
+    &ux_set_policy_function_0_step,
+    &ux_set_policy_function_1_step,
+    &ux_set_policy_function_2_step,
+    &ux_set_policy_function_3_step,
+};
+
+static void display_set_policy_flow(void) {
+    const signing_policy_t *allowed = policy();
+    uint8_t step = 0;
+
+    policy_flow[step++] = &ux_set_policy_flow_0_step;
+    policy_flow[step++] = &ux_set_policy_flow_1_step;
+    policy_flow[step++] = &ux_set_policy_flow_2_step;
+    if (allowed->limits.window != 0) {
+        policy_flow[step++] = &ux_set_policy_window_step;
+        policy_flow[step++] = &ux_set_policy_window_amount_step;
+        policy_flow[step++] = &ux_set_policy_window_count_step;
+    }
+    policy_flow[step++] = &ux_set_policy_receivers_count_step;
+    policy_flow[step++] = &ux_set_policy_receivers_upper_step;
+    policy_flow[step++] = &ux_set_policy_receiver_step;
+    policy_flow[step++] = &ux_set_policy_receivers_lower_step;
+    for (uint8_t i = 0; i < allowed->functions_count; i++) {
+        policy_flow[step++] = function_steps[i];
+    }
+    policy_flow[step++] = &ux_set_policy_flow_3_step;
+    policy_flow[step++] = &ux_set_policy_flow_4_step;
+    policy_flow[step++] = FLOW_END_STEP;
+
+    policy_context.paging_receivers = false;
+    ux_flow_init(0, policy_flow, NULL);
+}
+
+#endif
+
+// printable characters only. In a function name, '?' stands for the bytes of the data field that
+// cannot be shown and '@' ends the name
+static bool is_printable(const uint8_t *data, uint16_t length, bool function_name) {
+    for (uint16_t i = 0; i < length; i++) {
+        if (data[i] < 0x20 || data[i] > 0x7E ||
+            (function_name && (data[i] == '?' || data[i] == SC_ARGS_SEPARATOR))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// <window> + <max amount> + <max count>, the optional end of P1_POLICY_BEGIN
+#define SPENDING_LIMITS_LEN (4 + sizeof(uint128_t) + 2)
+
+// begin_policy disables the policy, writes the header of the new one and clears the spending
+static uint16_t begin_policy(const uint8_t *data_buffer, uint16_t data_length) {
+    char chain_id[MAX_CHAINID_LEN];
+    uint128_t max_amount;
+    spending_limits_t limits;
+    uint8_t count = 0;
+    uint8_t chain_id_len;
+    uint16_t header_len;
+
+    if (data_length < 1) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+    chain_id_len = data_buffer[0];
+    header_len = 1 + chain_id_len + sizeof(uint128_t);
+    if (chain_id_len == 0 || chain_id_len >= MAX_CHAINID_LEN ||
+        (data_length != header_len && data_length != header_len + SPENDING_LIMITS_LEN) ||
+        !is_printable(data_buffer + 1, chain_id_len, false)) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+
+    memset(&limits, 0, sizeof(limits));
+    if (data_length > header_len) {
+        const uint8_t *limits_buffer = data_buffer + header_len;
+        limits.window = read_uint32_be((uint8_t *) limits_buffer);
+        readu128BE((uint8_t *) limits_buffer + 4, &limits.max_amount);
+        limits.max_count = U2BE(limits_buffer, 4 + sizeof(uint128_t));
+        if (limits.window == 0 || limits.max_count == 0) {
+            return ERR_INVALID_ARGUMENTS;
+        }
+    }
+
+    memset(chain_id, 0, sizeof(chain_id));
+    memmove(chain_id, data_buffer + 1, chain_id_len);
+    readu128BE((uint8_t *) data_buffer + 1 + chain_id_len, &max_amount);
+    write_enabled(0);
+    nvm_write((void *) N_policy.chain_id, chain_id, sizeof(chain_id));
+    nvm_write((void *) &N_policy.max_amount, &max_amount, sizeof(max_amount));
+    nvm_write((void *) &N_policy.functions_count, &count, sizeof(count));
+    nvm_write((void *) &N_policy.limits, &limits, sizeof(limits));
+    clear_allowed_receivers();
+    reset_spending();
+
+    policy_context.state = POLICY_RECEIVING;
+    return MSG_OK;
+}
+
+static uint16_t add_function(const uint8_t *data_buffer, uint16_t data_length) {
+    char function[MAX_POLICY_FUNCTION_LEN + 1];
+    uint8_t count = N_policy.functions_count;
+
+    if (data_length == 0 || data_length > MAX_POLICY_FUNCTION_LEN ||
+        !is_printable(data_buffer, data_length, true)) {
+        return ERR_INVALID_ARGUMENTS;
+    }
+    if (count >= MAX_POLICY_FUNCTIONS) {
+        return ERR_INDEX_OUT_OF_BOUNDS;
+    }
+
+    memset(function, 0, sizeof(function));
+    memmove(function, data_buffer, data_length);
+    nvm_write((void *) N_policy.functions[count], function, sizeof(function));
+    count++;
+    nvm_write((void *) &N_policy.functions_count, &count, sizeof(count));
+    return MSG_OK;
+}
+
+static uint16_t review_policy(volatile unsigned int *flags) {
+    const signing_policy_t *allowed = policy();
+    uint128_t max_amount;
+
+    if (allowed_receivers_count() == 0) {
+        return ERR_INVALID_MESSAGE;
+    }
+
+    const char *ticker = TICKER_TESTNET;
+    if (strncmp(allowed->chain_id, MAINNET_CHAIN_ID, MAX_CHAINID_LEN) == 0) {
+        ticker = TICKER_MAINNET;
+    }
+    copy128(&max_amount, (uint128_t *) &allowed->max_amount);
+    if (!format_amount(&max_amount,
+                       DECIMAL_PLACES,
+                       ticker,
+                       policy_context.max_amount,
+                       sizeof(policy_context.max_amount))) {
+        return ERR_AMOUNT_TOO_LONG;
+    }
+    if (allowed->limits.window != 0) {
+        copy128(&max_amount, (uint128_t *) &allowed->limits.max_amount);
+        if (!format_amount(&max_amount,
+                           DECIMAL_PLACES,
+                           ticker,
+                           policy_context.window_max_amount,
+                           sizeof(policy_context.window_max_amount))) {
+            return ERR_AMOUNT_TOO_LONG;
+        }
+        uint32_t_to_char_array(allowed->limits.window, policy_context.window);
+        uint32_t_to_char_array(allowed->limits.max_count, policy_context.window_max_count);
+    }
+
+    uint32_t_to_char_array(allowed_receivers_count(), policy_context.receivers_count);
+
+    policy_context.state = POLICY_REVIEWING;
+#if defined(TARGET_STAX)
+    ui_set_policy_nbgl();
+#else
+    display_set_policy_flow();
+#endif
+    *flags |= IO_ASYNCH_REPLY;
+    return MSG_OK;
+}
+
+uint16_t handle_set_policy(uint8_t p1,
+                           uint8_t *data_buffer,
+                           uint16_t data_length,
+                           volatile unsigned int *flags) {
+    if (p1 == P1_POLICY_DISABLE) {
+        // giving up the policy needs no approval, and drops the one under review if any
+        policy_context.state = POLICY_IDLE;
+        write_enabled(0);
+        return MSG_OK;
+    }
+    if (p1 > P1_POLICY_CONFIRM) {
+        return ERR_INVALID_P1;
+    }
+    // the policy on screen cannot be changed
+    if (policy_context.state == POLICY_REVIEWING) {
+        return ERR_INVALID_MESSAGE;
+    }
+
+    if (p1 == P1_POLICY_BEGIN) {
+        return begin_policy(data_buffer, data_length);
+    }
+    if (policy_context.state != POLICY_RECEIVING) {
+        return ERR_INVALID_MESSAGE;
+    }
+    if (p1 == P1_POLICY_ADD_RECEIVER) {
+        return add_allowed_receivers(data_buffer, data_length);
+    }
+    if (p1 == P1_POLICY_ADD_FUNCTION) {
+        return add_function(data_buffer, data_length);
+    }
+    return review_policy(flags);
+}
@@ -0,0 +1,50 @@
+#ifndef _SIGNING_POLICY_H_
+#define _SIGNING_POLICY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <uint256.h>
+
+#include "constants.h"
+#include "spending_limits.h"
+
+// P1 of INS_SET_POLICY
+// <chain ID length> <chain ID> <max amount and fee, 16 bytes BE>, optionally followed by the limits
+// of a spending window: <window, 4 bytes BE> <max amount, 16 bytes BE> <max count, 2 bytes BE>
+#define P1_POLICY_BEGIN        0x00
+#define P1_POLICY_ADD_RECEIVER 0x01  // <public key> x n, in increasing order across the APDUs
+#define P1_POLICY_ADD_FUNCTION 0x02  // <function name, the decoded data field up to the first '@'>
+#define P1_POLICY_CONFIRM      0x03  // review the policy, it is enabled once approved
+#define P1_POLICY_DISABLE      0x04
+
+#define MAX_POLICY_FUNCTIONS    4
+#define MAX_POLICY_FUNCTION_LEN 32
+
+// transactions matching the policy are signed without being reviewed, see policy_allows_tx
+typedef struct signing_policy_t {
+    uint8_t enabled;
+    char chain_id[MAX_CHAINID_LEN];
+    uint128_t max_amount;  // value plus fee of a single transaction
+    uint8_t functions_count;
+    char functions[MAX_POLICY_FUNCTIONS][MAX_POLICY_FUNCTION_LEN + 1];
+    spending_limits_t limits;  // over all the transactions signed without review
+} signing_policy_t;
+
+extern const signing_policy_t N_policy_real;
+#define N_policy (*(volatile signing_policy_t *) PIC(&N_policy_real))
+
+bool policy_enabled(void);
+// policy_allows_tx tells if the fully parsed transaction can be signed without review
+bool policy_allows_tx(void);
+// policy_record_tx counts a transaction signed without review in the spending window
+void policy_record_tx(void);
+// policy_count_batch_tx counts a transaction of a batch in the spending window, false when it
+// does not fit. The batch is only reviewed as a summary, so it is bound by the same limits
+bool policy_count_batch_tx(void);
+uint16_t handle_get_spending_limits(volatile unsigned int *tx);
+uint16_t handle_set_policy(uint8_t p1,
+                           uint8_t *data_buffer,
+                           uint16_t data_length,
+                           volatile unsigned int *flags);
+
+#endif
@@ -0,0 +1,290 @@
+#include "spending_limits.h"
+#include "constants.h"
+#include "globals.h"
+
+/*
+   The device has no clock, so a spending window is a range of consecutive nonces of the account.
+   The window slides: a transaction with nonce n is checked against the transactions with a nonce
+   in [n - window + 1, n], so the limits hold over any window consecutive nonces. A transaction
+   with a nonce below the last one counted is never signed without review.
+
+   Each account keeps SPENDING_BUCKETS buckets of the amount and count of the transactions, a
+   bucket holding window / (SPENDING_BUCKETS - 1) consecutive nonces, rounded up. Any window
+   consecutive nonces span at most SPENDING_BUCKETS buckets, which are summed whole: up to a bucket
+   of nonces before the window is counted with it, so the window may refuse a transaction early
+   but never lets one go over the limits.
+
+   The counters survive restarts without a flash write per signature: flash holds a reservation,
+   ahead of the spending of the last bucket by an eighth of the limits, which is only written again
+   once the counters kept in RAM go past it or move to another bucket. After a restart the counters
+   start from the reservation, so losing the RAM can only leave part of the limits unused.
+
+   query response, the counters of the accounts that spent something:
+   <window> + <max amount> + <max count> + <accounts> +
+    4 bytes     16 bytes       2 bytes      1 byte
+   n x (<account> + <address index> + <last nonce> + <amount> + <count>)
+         4 bytes       4 bytes          8 bytes      16 bytes   2 bytes
+   where the amount and the count are those of the window ending at the last nonce.
+*/
+
+// the reservation is ahead of the counters by 1 << SPENDING_RESERVE_SHIFT of the limits
+#define SPENDING_RESERVE_SHIFT 3
+#define SPENDING_BUCKETS       4
+
+typedef struct spending_counter_t {
+    uint8_t used;
+    uint32_t account;
+    uint32_t address_index;
+    uint64_t last_nonce;  // highest nonce counted
+    // the buckets of the nonces up to last_nonce, bucket b in slot b % SPENDING_BUCKETS
+    uint128_t amounts[SPENDING_BUCKETS];
+    uint16_t counts[SPENDING_BUCKETS];
+} spending_counter_t;
+
+static const spending_counter_t N_spending_real[MAX_SPENDING_ACCOUNTS];
+#define N_spending ((volatile spending_counter_t *) PIC(N_spending_real))
+
+// the counters since the app started, loaded from the reservations on first use
+static spending_counter_t spending[MAX_SPENDING_ACCOUNTS];
+static bool spending_loaded;
+
+// a counter as it was before a batch, see checkpoint_spending
+static spending_counter_t checkpoint;
+static int8_t checkpoint_index = -1;
+
+static void load_spending(void) {
+    if (!spending_loaded) {
+        memmove(spending, (const void *) N_spending, sizeof(spending));
+        spending_loaded = true;
+    }
+}
+
+void reset_spending(void) {
+    memset(spending, 0, sizeof(spending));
+    nvm_write((void *) N_spending, spending, sizeof(spending));
+    spending_loaded = true;
+    checkpoint_index = -1;
+}
+
+// find_counter returns the counter of the current account or a free one, NULL when all are taken
+static spending_counter_t *find_counter(void) {
+    spending_counter_t *free_counter = NULL;
+
+    load_spending();
+    for (uint8_t i = 0; i < MAX_SPENDING_ACCOUNTS; i++) {
+        if (!spending[i].used) {
+            if (free_counter == NULL) {
+                free_counter = &spending[i];
+            }
+        } else if (spending[i].account == bip32_account &&
+                   spending[i].address_index == bip32_address_index) {
+            return &spending[i];
+        }
+    }
+    return free_counter;
+}
+
+static uint64_t bucket_of(const spending_limits_t *limits, uint64_t nonce) {
+    uint32_t width = (limits->window + SPENDING_BUCKETS - 2) / (SPENDING_BUCKETS - 1);
+    return nonce / width;
+}
+
+// window_spending sums up the buckets of the window ending at nonce, which is not below the last
+// nonce of the counter, false on overflow
+static bool window_spending(const spending_limits_t *limits,
+                            const spending_counter_t *counter,
+                            uint64_t nonce,
+                            uint128_t *amount,
+                            uint32_t *count) {
+    uint64_t first = 0;
+    uint128_t total;
+
+    clear128(amount);
+    *count = 0;
+    if (!counter->used) {
+        return true;
+    }
+    if (nonce >= limits->window) {
+        first = bucket_of(limits, nonce - limits->window + 1);
+    }
+    // the buckets after the last nonce are empty
+    for (uint64_t b = first; b <= bucket_of(limits, counter->last_nonce); b++) {
+        uint8_t slot = b % SPENDING_BUCKETS;
+        add128(amount, (uint128_t *) &counter->amounts[slot], &total);
+        if (gt128(amount, &total)) {
+            return false;
+        }
+        copy128(amount, &total);
+        *count += counter->counts[slot];
+    }
+    return true;
+}
+
+bool spending_allows_tx(const spending_limits_t *limits, uint64_t nonce, uint128_t *amount) {
+    const spending_counter_t *counter;
+    uint128_t max_amount;
+    uint128_t spent;
+    uint128_t total;
+    uint32_t count;
+
+    if (limits->window == 0) {
+        return true;
+    }
+    counter = find_counter();
+    if (counter == NULL || (counter->used && nonce < counter->last_nonce)) {
+        return false;
+    }
+    if (!window_spending(limits, counter, nonce, &spent, &count) || count >= limits->max_count) {
+        return false;
+    }
+    add128(&spent, amount, &total);
+    if (gt128(amount, &total)) {
+        return false;
+    }
+
+    copy128(&max_amount, (uint128_t *) &limits->max_amount);
+    return !gt128(&total, &max_amount);
+}
+
+// reserve_spending writes the counter to flash, its last bucket ahead of the spending
+static void reserve_spending(const spending_limits_t *limits, uint8_t index) {
+    spending_counter_t reservation = spending[index];
+    uint8_t slot = bucket_of(limits, reservation.last_nonce) % SPENDING_BUCKETS;
+    uint128_t max_amount;
+    uint128_t step;
+    uint16_t count_step = limits->max_count >> SPENDING_RESERVE_SHIFT;
+
+    copy128(&max_amount, (uint128_t *) &limits->max_amount);
+    shiftr128(&max_amount, SPENDING_RESERVE_SHIFT, &step);
+    add128(&spending[index].amounts[slot], &step, &reservation.amounts[slot]);
+    if (gt128(&reservation.amounts[slot], &max_amount) ||
+        gt128(&spending[index].amounts[slot], &reservation.amounts[slot])) {
+        copy128(&reservation.amounts[slot], &max_amount);
+    }
+    if (count_step == 0) {
+        count_step = 1;
+    }
+    if (limits->max_count - reservation.counts[slot] > count_step) {
+        reservation.counts[slot] += count_step;
+    } else {
+        reservation.counts[slot] = limits->max_count;
+    }
+
+    nvm_write((void *) &N_spending[index], &reservation, sizeof(reservation));
+}
+
+void record_spending(const spending_limits_t *limits, uint64_t nonce, uint128_t *amount) {
+    spending_counter_t *counter;
+    volatile spending_counter_t *reserved;
+    uint128_t total;
+    uint128_t reserved_amount;
+
+    if (limits->window == 0 || (counter = find_counter()) == NULL) {
+        return;
+    }
+
+    if (!counter->used) {
+        memset(counter, 0, sizeof(*counter));
+        counter->used = 1;
+        counter->account = bip32_account;
+        counter->address_index = bip32_address_index;
+        counter->last_nonce = nonce;
+    } else if (nonce > counter->last_nonce) {
+        // empty the slots of the buckets between the last nonce and this one
+        uint64_t last = bucket_of(limits, counter->last_nonce);
+        uint64_t gap = bucket_of(limits, nonce) - last;
+        if (gap > SPENDING_BUCKETS) {
+            gap = SPENDING_BUCKETS;
+        }
+        for (uint64_t b = last + 1; b <= last + gap; b++) {
+            clear128(&counter->amounts[b % SPENDING_BUCKETS]);
+            counter->counts[b % SPENDING_BUCKETS] = 0;
+        }
+        counter->last_nonce = nonce;
+    }
+    uint8_t slot = bucket_of(limits, counter->last_nonce) % SPENDING_BUCKETS;
+    add128(&counter->amounts[slot], amount, &total);
+    copy128(&counter->amounts[slot], &total);
+    counter->counts[slot]++;
+
+    reserved = &N_spending[counter - spending];
+    copy128(&reserved_amount, (uint128_t *) &reserved->amounts[slot]);
+    if (!reserved->used || reserved->account != counter->account ||
+        reserved->address_index != counter->address_index ||
+        bucket_of(limits, reserved->last_nonce) != bucket_of(limits, counter->last_nonce) ||
+        gt128(&counter->amounts[slot], &reserved_amount) ||
+        counter->counts[slot] > reserved->counts[slot]) {
+        reserve_spending(limits, counter - spending);
+    }
+}
+
+void checkpoint_spending(void) {
+    spending_counter_t *counter = find_counter();
+
+    checkpoint_index = -1;
+    if (counter != NULL) {
+        checkpoint = *counter;
+        checkpoint_index = counter - spending;
+    }
+}
+
+void rollback_spending(void) {
+    if (checkpoint_index >= 0) {
+        spending[checkpoint_index] = checkpoint;
+        checkpoint_index = -1;
+    }
+}
+
+static uint8_t *write_u16(uint8_t *buffer, uint16_t value) {
+    buffer[0] = value >> 8;
+    buffer[1] = value;
+    return buffer + 2;
+}
+
+static uint8_t *write_u32(uint8_t *buffer, uint32_t value) {
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+    return buffer + 4;
+}
+
+static uint8_t *write_u64(uint8_t *buffer, uint64_t value) {
+    buffer = write_u32(buffer, value >> 32);
+    return write_u32(buffer, value);
+}
+
+uint16_t handle_get_spending(const spending_limits_t *limits, volatile unsigned int *tx) {
+    uint8_t *out = G_io_apdu_buffer;
+    uint8_t *accounts;
+    uint128_t amount;
+    uint32_t count;
+
+    out = write_u32(out, limits->window);
+    out = write_u64(out, UPPER(limits->max_amount));
+    out = write_u64(out, LOWER(limits->max_amount));
+    out = write_u16(out, limits->max_count);
+    accounts = out++;
+    *accounts = 0;
+
+    load_spending();
+    for (uint8_t i = 0; i < MAX_SPENDING_ACCOUNTS; i++) {
+        if (!spending[i].used || limits->window == 0) {
+            continue;
+        }
+        if (!window_spending(limits, &spending[i], spending[i].last_nonce, &amount, &count)) {
+            UPPER(amount) = UINT64_MAX;
+            LOWER(amount) = UINT64_MAX;
+        }
+        out = write_u32(out, spending[i].account);
+        out = write_u32(out, spending[i].address_index);
+        out = write_u64(out, spending[i].last_nonce);
+        out = write_u64(out, UPPER(amount));
+        out = write_u64(out, LOWER(amount));
+        out = write_u16(out, count > UINT16_MAX ? UINT16_MAX : count);
+        (*accounts)++;
+    }
+
+    *tx = out - G_io_apdu_buffer;
+    return MSG_OK;
+}
@@ -0,0 +1,29 @@
+#ifndef _SPENDING_LIMITS_H_
+#define _SPENDING_LIMITS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <uint256.h>
+
+// accounts whose spending is tracked at the same time
+#define MAX_SPENDING_ACCOUNTS 4
+
+// the limits of any window consecutive account nonces, none when window is 0
+typedef struct spending_limits_t {
+    uint32_t window;
+    uint128_t max_amount;  // value plus fee of all the transactions of the window
+    uint16_t max_count;
+} spending_limits_t;
+
+void reset_spending(void);
+// spending_allows_tx tells if a transaction of the current account fits in its window
+bool spending_allows_tx(const spending_limits_t *limits, uint64_t nonce, uint128_t *amount);
+// record_spending counts a signed transaction of the current account
+void record_spending(const spending_limits_t *limits, uint64_t nonce, uint128_t *amount);
+// checkpoint_spending remembers the counter of the current account, rollback_spending gives back
+// what was counted since, for transactions that were not signed after all
+void checkpoint_spending(void);
+void rollback_spending(void);
+uint16_t handle_get_spending(const spending_limits_t *limits, volatile unsigned int *tx);
+
+#endif
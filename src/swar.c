@@ -0,0 +1,215 @@
+#include "swar.h"
+
+#ifndef SWAR_SCALAR
+// the device cores are 32-bit, where every 64-bit operation takes a register pair and a
+// multiplication several instructions, so the words only have 64 bits on 64-bit hosts
+#if defined(SWAR_WORD32) || UINTPTR_MAX <= 0xFFFFFFFF
+#define WORD_BITS 32
+typedef uint32_t word_t;
+#else
+#define WORD_BITS 64
+typedef uint64_t word_t;
+#endif
+#define WORD_BYTES (WORD_BITS / 8)
+
+#define ONES       ((word_t) ~(word_t) 0 / 0xFF)
+#define HIGH_BITS  (ONES * 0x80)
+#define LOW_NIBBLE (ONES * 0x0F)
+#define LOW_BYTES  ((word_t) ~(word_t) 0 / 0xFFFF * 0xFF)  // low byte of every 16-bit lane
+// each byte of the word set to c
+#define REPEAT(c) (ONES * (uint8_t) (c))
+
+// loads a word of characters, the first one in the low byte whatever the endianness
+static word_t load_word(const char *str) {
+    word_t word = 0;
+    for (int i = WORD_BYTES - 1; i >= 0; i--) {
+        word = (word << 8) | (uint8_t) str[i];
+    }
+    return word;
+}
+
+static void store_word(char *dst, word_t word) {
+    for (int i = 0; i < WORD_BYTES; i++) {
+        dst[i] = (char) (word >> (8 * i));
+    }
+}
+
+// high bit of every byte set where the byte is >= c, for bytes below 0x80 so
+// that no carry crosses into the next byte
+static word_t bytes_ge(word_t word, uint8_t c) {
+    return (word + REPEAT(0x80 - c)) & HIGH_BITS;
+}
+
+static bool word_is_digits(word_t word) {
+    // every high nibble is 3 and adding 6 to the low one does not carry
+    return ((word & ~LOW_NIBBLE) == REPEAT('0')) &&
+           (((word + REPEAT(6)) & ~LOW_NIBBLE) == REPEAT('0'));
+}
+
+#if WORD_BITS == 64
+#define WORD_DIGITS_SCALE 100000000
+#else
+#define WORD_DIGITS_SCALE 10000
+#endif
+
+// value of the digits of a word, first one the most significant
+static uint32_t word_digits_value(word_t word) {
+    word -= REPEAT('0');
+    word = (word * 10 + (word >> 8)) & LOW_BYTES;
+#if WORD_BITS == 64
+    word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+    return (uint32_t) (word * 10000 + (word >> 32));
+#else
+    return (uint32_t) ((word * 100 + (word >> 16)) & 0xFFFF);
+#endif
+}
+
+// true if the bytes are hex digits, letters gets the high bit of every
+// letter byte
+static bool word_hex_letters(word_t word, word_t *letters) {
+    if ((word & HIGH_BITS) != 0) {
+        return false;
+    }
+    word_t digits = bytes_ge(word, '0') & ~bytes_ge(word, '9' + 1);
+    word_t upper = bytes_ge(word, 'A') & ~bytes_ge(word, 'F' + 1);
+    word_t lower = bytes_ge(word, 'a') & ~bytes_ge(word, 'f' + 1);
+    *letters = upper | lower;
+    return (digits | upper | lower) == HIGH_BITS;
+}
+
+// value of the validated hex digits of a word, first one the most significant
+static uint32_t word_hex_value(word_t word) {
+    word_t letters;
+    word_hex_letters(word, &letters);
+    // low nibble of the character, plus 9 for letters
+    word = (word & LOW_NIBBLE) + (letters >> 7) * 9;
+    // pack the nibbles, the first character being the most significant
+    word = ((word & LOW_BYTES) << 4) | ((word >> 8) & LOW_BYTES);
+#if WORD_BITS == 64
+    word = ((word & 0x0000FFFF0000FFFFULL) << 8) | ((word >> 16) & 0x0000FFFF0000FFFFULL);
+    return (uint32_t) ((word << 16) | (word >> 32));
+#else
+    return (uint32_t) (((word & 0xFF) << 8) | ((word >> 16) & 0xFF));
+#endif
+}
+#endif
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool swar_is_digits(const char *str, size_t len) {
+    size_t i = 0;
+#ifndef SWAR_SCALAR
+    for (; i + WORD_BYTES <= len; i += WORD_BYTES) {
+        if (!word_is_digits(load_word(str + i))) {
+            return false;
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (!is_digit(str[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool swar_parse_u64(const char *str, size_t len, uint64_t *result) {
+    uint64_t n = 0;
+    size_t i = 0;
+#ifndef SWAR_SCALAR
+    for (; i + WORD_BYTES <= len; i += WORD_BYTES) {
+        word_t word = load_word(str + i);
+        if (!word_is_digits(word)) {
+            return false;
+        }
+        uint32_t chunk = word_digits_value(word);
+        if (n > (UINT64_MAX - chunk) / WORD_DIGITS_SCALE) {
+            return false;
+        }
+        n = n * WORD_DIGITS_SCALE + chunk;
+    }
+#endif
+    for (; i < len; i++) {
+        if (!is_digit(str[i])) {
+            return false;
+        }
+        uint8_t digit = str[i] - '0';
+        if (n > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        n = n * 10 + digit;
+    }
+    *result = n;
+    return true;
+}
+
+bool swar_is_hex_digits(const char *str, size_t len) {
+    size_t i = 0;
+#ifndef SWAR_SCALAR
+    word_t letters;
+    for (; i + WORD_BYTES <= len; i += WORD_BYTES) {
+        if (!word_hex_letters(load_word(str + i), &letters)) {
+            return false;
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        char c = str[i];
+        if (!(is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t swar_hex_value(char c) {
+    if (c >= 'a') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A') {
+        return c - 'A' + 10;
+    }
+    return c - '0';
+}
+
+uint32_t swar_hex8_value(const char *str) {
+#ifndef SWAR_SCALAR
+#if WORD_BITS == 64
+    return word_hex_value(load_word(str));
+#else
+    return (word_hex_value(load_word(str)) << 16) | word_hex_value(load_word(str + 4));
+#endif
+#else
+    uint32_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 4) | swar_hex_value(str[i]);
+    }
+    return value;
+#endif
+}
+
+void swar_hex_encode(char *dst, const uint8_t *src, size_t len, bool uppercase) {
+    const char *hex = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    size_t i = 0;
+#ifndef SWAR_SCALAR
+    // distance from '9' + 1 to the first letter
+    word_t letter_offset = uppercase ? 'A' - '9' - 1 : 'a' - '9' - 1;
+    for (; i + WORD_BYTES / 2 <= len; i += WORD_BYTES / 2) {
+        // one byte per 16-bit lane, then spread its nibbles high first
+        word_t word = 0;
+        for (int k = WORD_BYTES / 2 - 1; k >= 0; k--) {
+            word = (word << 16) | src[i + k];
+        }
+        word = ((word >> 4) | (word << 8)) & LOW_NIBBLE;
+        // nibbles from 10 up carry into bit 4 once 6 is added
+        word_t letters = ((word + REPEAT(6)) >> 4) & ONES;
+        store_word(dst + 2 * i, word + REPEAT('0') + letters * letter_offset);
+    }
+#endif
+    for (; i < len; i++) {
+        dst[2 * i] = hex[src[i] >> 4];
+        dst[2 * i + 1] = hex[src[i] & 0x0F];
+    }
+}
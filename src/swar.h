@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// SWAR (SIMD within a register) kernels for the ASCII hot loops: the
+// characters are validated or converted a word at a time, 4 per 32-bit word on
+// the device and 8 per 64-bit word on 64-bit hosts, and the remaining ones go
+// through the scalar code. Define SWAR_WORD32 to use 32-bit words everywhere,
+// SWAR_SCALAR to only use the scalar code.
+
+bool is_digit(char c);
+
+// true if the len characters of str are all decimal digits
+bool swar_is_digits(const char *str, size_t len);
+
+// parses len decimal digits into result, false on a non digit or if the value
+// does not fit in 64 bits
+bool swar_parse_u64(const char *str, size_t len, uint64_t *result);
+
+// true if the len characters of str are all hex digits, either case
+bool swar_is_hex_digits(const char *str, size_t len);
+
+// value of the 8 hex digits at str, which must have been validated
+uint32_t swar_hex8_value(const char *str);
+
+// value of a single validated hex digit
+uint8_t swar_hex_value(char c);
+
+// writes the 2 * len hex digits of src to dst, without a terminator
+void swar_hex_encode(char *dst, const uint8_t *src, size_t len, bool uppercase);
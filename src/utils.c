@@ -2,6 +2,8 @@
 #include "menu.h"
 #include "os.h"
 #include "base64.h"
+#include "get_private_key.h"
+#include "swar.h"
 
 #ifdef HAVE_NBGL
 #include "nbgl_use_case.h"
@@ -13,17 +15,19 @@ uint32_t read_uint32_be(uint8_t* buffer) {
     return (buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | (buffer[3]);
 }
 
-void send_response(uint8_t tx, bool approve, bool back_to_idle) {
-    uint16_t response;
+void send_response(uint16_t tx, bool approve, bool back_to_idle) {
+    send_status(tx, approve ? MSG_OK : ERR_USER_DENIED, back_to_idle);
+}
 
-    if (approve) {
-        response = MSG_OK;
-    } else {
-        response = ERR_USER_DENIED;
+// send_status ends an asynchronous command with any status word, the cached key is dropped
+// whenever the command did not succeed
+void send_status(uint16_t tx, uint16_t sw, bool back_to_idle) {
+    if (sw != MSG_OK) {
+        clear_private_key_cache();
     }
 
-    G_io_apdu_buffer[tx++] = response >> 8;
-    G_io_apdu_buffer[tx++] = response & 0xff;
+    G_io_apdu_buffer[tx++] = sw >> 8;
+    G_io_apdu_buffer[tx++] = sw & 0xff;
     // Send back the response, do not restart the event loop
     io_exchange(CHANNEL_APDU | IO_RETURN_AFTER_TX, tx);
 
@@ -33,10 +37,6 @@ void send_response(uint8_t tx, bool approve, bool back_to_idle) {
     }
 }
 
-bool is_digit(char c) {
-    return c >= '0' && c <= '9';
-}
-
 // TODO: refactor this function
 void uint32_t_to_char_array(uint32_t const input, char* output) {
     uint32_t const base = 10;
@@ -55,18 +55,12 @@ void convert_to_hex_str(char* destination,
                         size_t destination_size,
                         const uint8_t* source,
                         size_t source_size) {
-    static char hex[] = "0123456789ABCDEF";
-    int i = 0;
-
     if (source_size * 2 > destination_size) {
         source_size = destination_size / 2;
     }
 
-    for (i = 0; i < (int) source_size; i++) {
-        destination[(i * 2)] = hex[((source[i] & 0xF0) >> 4)];
-        destination[(i * 2) + 1] = hex[((source[i] & 0x0F) >> 0)];
-    }
-    destination[i * 2] = '\0';
+    swar_hex_encode(destination, source, source_size, true);
+    destination[source_size * 2] = '\0';
 }
 
 /*
@@ -9,9 +9,8 @@
 
 uint32_t read_uint32_be(uint8_t* buffer);
 
-void send_response(uint8_t tx, bool approve, bool back_to_idle);
-
-bool is_digit(char c);
+void send_response(uint16_t tx, bool approve, bool back_to_idle);
+void send_status(uint16_t tx, uint16_t sw, bool back_to_idle);
 
 void uint32_t_to_char_array(uint32_t const input, char* output);
 
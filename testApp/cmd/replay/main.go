@@ -0,0 +1,285 @@
+// replay feeds a trace recorded with LEDGER_TRACE (see the trace package) to
+// Speculos or to the host simulation build of the app, and reports the
+// latency percentiles of every instruction.
+//
+//	replay -trace session.jsonl -simulation ./build-sim/simulation -iterations 100
+//	replay -trace session.jsonl -speculos 127.0.0.1:9999
+//
+// Speculos does not confirm the review screens by itself: start it with an
+// --automation file approving them when the trace contains signing requests.
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"encoding/hex"
+	"encoding/json"
+	"errors"
+	"flag"
+	"fmt"
+	"io"
+	"log"
+	"math"
+	"net"
+	"os"
+	"os/exec"
+	"sort"
+	"strings"
+	"time"
+
+	"github.com/ElrondNetwork/ledger-elrond/testApp/trace"
+)
+
+const (
+	errNoTrace        = "-trace is required"
+	errOneTarget      = "exactly one of -speculos and -simulation must be set"
+	errEmptyTrace     = "the trace has no exchange"
+	errSimulationExit = "the simulation exited before answering"
+	maxMismatchLogs   = 10
+)
+
+var insNames = map[byte]string{
+	0x01: "GET_APP_VERSION",
+	0x02: "GET_APP_CONFIGURATION",
+	0x03: "GET_ADDR",
+	0x04: "SIGN_TX",
+	0x05: "SET_ADDR",
+	0x06: "SIGN_MSG",
+	0x07: "SIGN_TX_HASH",
+	0x08: "PROVIDE_ESDT_INFO",
+	0x09: "GET_ADDR_AUTH_TOKEN",
+	0x0A: "SIGN_TX_HASH_ONLY",
+	0x0B: "GET_ADDR_BATCH",
+	0x0C: "GET_PERF_STATS",
+	0x0D: "GET_CAPABILITIES",
+	0x0E: "SIGN_TX_BATCH",
+	0x0F: "SIGN_TX_QUEUE",
+	0x10: "SET_POLICY",
+	0x11: "GET_SPENDING_LIMITS",
+}
+
+type transport interface {
+	Exchange(apdu []byte) ([]byte, error)
+	Close() error
+}
+
+// speculosTransport talks to the APDU port of Speculos: a 4-byte big endian
+// length prefixes the command, and the data length the response, whose status
+// word follows
+type speculosTransport struct {
+	conn net.Conn
+}
+
+func (t *speculosTransport) Exchange(apdu []byte) ([]byte, error) {
+	header := make([]byte, 4)
+	binary.BigEndian.PutUint32(header, uint32(len(apdu)))
+	if _, err := t.conn.Write(append(header, apdu...)); err != nil {
+		return nil, err
+	}
+	if _, err := io.ReadFull(t.conn, header); err != nil {
+		return nil, err
+	}
+	resp := make([]byte, binary.BigEndian.Uint32(header)+2)
+	_, err := io.ReadFull(t.conn, resp)
+	return resp, err
+}
+
+func (t *speculosTransport) Close() error {
+	return t.conn.Close()
+}
+
+// simulationTransport drives the host build, which reads one hex APDU per line
+// and answers with one hex line
+type simulationTransport struct {
+	cmd    *exec.Cmd
+	stdin  io.WriteCloser
+	stdout *bufio.Reader
+}
+
+func newSimulationTransport(path string) (*simulationTransport, error) {
+	cmd := exec.Command(path)
+	cmd.Stderr = os.Stderr
+	stdin, err := cmd.StdinPipe()
+	if err != nil {
+		return nil, err
+	}
+	stdout, err := cmd.StdoutPipe()
+	if err != nil {
+		return nil, err
+	}
+	if err = cmd.Start(); err != nil {
+		return nil, err
+	}
+	return &simulationTransport{cmd: cmd, stdin: stdin, stdout: bufio.NewReader(stdout)}, nil
+}
+
+func (t *simulationTransport) Exchange(apdu []byte) ([]byte, error) {
+	if _, err := fmt.Fprintf(t.stdin, "%x\n", apdu); err != nil {
+		return nil, err
+	}
+	line, err := t.stdout.ReadString('\n')
+	if err == io.EOF {
+		return nil, errors.New(errSimulationExit)
+	}
+	if err != nil {
+		return nil, err
+	}
+	return hex.DecodeString(strings.TrimSpace(line))
+}
+
+func (t *simulationTransport) Close() error {
+	t.stdin.Close()
+	return t.cmd.Wait()
+}
+
+type insReport struct {
+	INS   string  `json:"ins"`
+	Count int     `json:"count"`
+	P50   float64 `json:"p50_us"`
+	P90   float64 `json:"p90_us"`
+	P99   float64 `json:"p99_us"`
+	Max   float64 `json:"max_us"`
+}
+
+type report struct {
+	Iterations int         `json:"iterations"`
+	Exchanges  int         `json:"exchanges"`
+	Mismatches int         `json:"mismatches"`
+	TotalMs    float64     `json:"total_ms"`
+	PerINS     []insReport `json:"per_ins"`
+}
+
+// percentile returns the nearest-rank percentile of sorted durations
+func percentile(sorted []time.Duration, p float64) time.Duration {
+	rank := int(math.Ceil(p / 100 * float64(len(sorted))))
+	if rank < 1 {
+		rank = 1
+	}
+	return sorted[rank-1]
+}
+
+func microseconds(d time.Duration) float64 {
+	return float64(d.Nanoseconds()) / 1e3
+}
+
+func insName(ins byte) string {
+	if name, ok := insNames[ins]; ok {
+		return name
+	}
+	return fmt.Sprintf("0x%02x", ins)
+}
+
+func buildReport(latencies map[byte][]time.Duration) []insReport {
+	var inss []int
+	for ins := range latencies {
+		inss = append(inss, int(ins))
+	}
+	sort.Ints(inss)
+
+	var reports []insReport
+	for _, ins := range inss {
+		durations := latencies[byte(ins)]
+		sort.Slice(durations, func(i, j int) bool { return durations[i] < durations[j] })
+		reports = append(reports, insReport{
+			INS:   insName(byte(ins)),
+			Count: len(durations),
+			P50:   microseconds(percentile(durations, 50)),
+			P90:   microseconds(percentile(durations, 90)),
+			P99:   microseconds(percentile(durations, 99)),
+			Max:   microseconds(durations[len(durations)-1]),
+		})
+	}
+	return reports
+}
+
+func openTransport(speculos, simulation string) (transport, error) {
+	if (speculos == "") == (simulation == "") {
+		return nil, errors.New(errOneTarget)
+	}
+	if speculos != "" {
+		conn, err := net.Dial("tcp", speculos)
+		if err != nil {
+			return nil, err
+		}
+		return &speculosTransport{conn: conn}, nil
+	}
+	return newSimulationTransport(simulation)
+}
+
+func main() {
+	log.SetFlags(0)
+
+	tracePath := flag.String("trace", "", "trace recorded with LEDGER_TRACE")
+	speculos := flag.String("speculos", "", "address of the Speculos APDU port, e.g. 127.0.0.1:9999")
+	simulation := flag.String("simulation", "", "path of the host simulation build")
+	iterations := flag.Int("iterations", 1, "number of times the trace is replayed")
+	check := flag.Bool("check", false, "compare the responses with the recorded ones")
+	jsonOutput := flag.Bool("json", false, "print the report as JSON")
+	flag.Parse()
+
+	if *tracePath == "" {
+		log.Fatal(errNoTrace)
+	}
+	file, err := os.Open(*tracePath)
+	if err != nil {
+		log.Fatal(err)
+	}
+	entries, err := trace.Read(file)
+	file.Close()
+	if err != nil {
+		log.Fatal(err)
+	}
+	if len(entries) == 0 {
+		log.Fatal(errEmptyTrace)
+	}
+
+	device, err := openTransport(*speculos, *simulation)
+	if err != nil {
+		log.Fatal(err)
+	}
+
+	result := report{Iterations: *iterations}
+	latencies := make(map[byte][]time.Duration)
+	start := time.Now()
+	for i := 0; i < *iterations; i++ {
+		for _, entry := range entries {
+			sent := time.Now()
+			resp, err := device.Exchange(entry.APDU)
+			elapsed := time.Since(sent)
+			if err != nil {
+				log.Fatalf("exchange %d: %v", result.Exchanges, err)
+			}
+			latencies[entry.INS()] = append(latencies[entry.INS()], elapsed)
+			if *check && !bytes.Equal(resp, entry.Response) {
+				if result.Mismatches < maxMismatchLogs {
+					log.Printf("exchange %d: got %x, recorded %x", result.Exchanges, resp, []byte(entry.Response))
+				}
+				result.Mismatches++
+			}
+			result.Exchanges++
+		}
+	}
+	result.TotalMs = float64(time.Since(start).Nanoseconds()) / 1e6
+	if err = device.Close(); err != nil {
+		log.Fatal(err)
+	}
+	result.PerINS = buildReport(latencies)
+
+	if *jsonOutput {
+		encoder := json.NewEncoder(os.Stdout)
+		encoder.SetIndent("", "  ")
+		if err = encoder.Encode(result); err != nil {
+			log.Fatal(err)
+		}
+	} else {
+		fmt.Printf("%d exchanges in %.1f ms, %d mismatches\n", result.Exchanges, result.TotalMs, result.Mismatches)
+		fmt.Printf("%-22s %8s %10s %10s %10s %10s\n", "INS", "count", "p50 us", "p90 us", "p99 us", "max us")
+		for _, r := range result.PerINS {
+			fmt.Printf("%-22s %8d %10.1f %10.1f %10.1f %10.1f\n", r.INS, r.Count, r.P50, r.P90, r.P99, r.Max)
+		}
+	}
+	if result.Mismatches > 0 {
+		os.Exit(1)
+	}
+}
@@ -7,7 +7,11 @@ import (
 	"errors"
 	"fmt"
 	"math"
+	"math/big"
+	"os"
+	"sort"
 
+	"github.com/ElrondNetwork/ledger-elrond/testApp/trace"
 	"github.com/karalabe/hid"
 )
 
@@ -23,6 +27,11 @@ const (
 	cmdSignTxnHash            = 0x07
 	cmdProvideESDTInfo        = 0x08
 	cmdGetAddressAndAuthToken = 0x09
+	cmdGetCapabilities        = 0x0d
+	cmdSignTxnBatch           = 0x0e
+	cmdSignTxnQueue           = 0x0f
+	cmdSetPolicy              = 0x10
+	cmdGetSpendingLimits      = 0x11
 
 	p1WithConfirmation = 0x01
 	p1NoConfirmation   = 0x00
@@ -30,6 +39,16 @@ const (
 	p2DisplayHex       = 0x01
 	p1First            = 0x00
 	p1More             = 0x80
+	p1BatchNextTx      = 0x01
+	p1BatchReview      = 0x02
+	p1BatchSign        = 0x03
+	p1QueueNextTx      = 0x01
+	p1QueueReview      = 0x02
+	p1PolicyBegin      = 0x00
+	p1PolicyReceiver   = 0x01
+	p1PolicyFunction   = 0x02
+	p1PolicyConfirm    = 0x03
+	p1PolicyDisable    = 0x04
 )
 
 const (
@@ -51,17 +70,51 @@ const (
 	codeInvalidFee           = 0x6e0c
 	codePrettyFailed         = 0x6e0d
 	codeDataTooLong          = 0x6e0e
+	codeNotPlainTransfer     = 0x6e16
+	codeSpendingLimit        = 0x6e17
 )
 
+// capability bits of GetCapabilities
 const (
-	errBadConfigResponse  = "GetConfiguration erroneous response"
-	errBadAddressResponse = "Invalid get address response"
-	errBadSignature       = "Invalid signature received from Ledger"
-	errNotDetected        = "Nano S not detected"
+	CapabilityAddressBatch = 1 << iota
+	CapabilityKeyCache
+	CapabilityHashSigning
+	CapabilityReturnHash
+	CapabilityPerfStats
+	CapabilityTxBatch
+	CapabilityTxQueue
+	CapabilitySigningPolicy
 )
 
+const (
+	errBadConfigResponse       = "GetConfiguration erroneous response"
+	errBadCapabilitiesResponse = "GetCapabilities erroneous response"
+	errBadAddressResponse      = "Invalid get address response"
+	errBadSignature            = "Invalid signature received from Ledger"
+	errBadBatchTicket          = "Invalid batch ticket received from Ledger"
+	errBadSpendingResponse     = "GetSpendingLimits erroneous response"
+	errNotDetected             = "Nano S not detected"
+)
+
+// traceEnvVar names the file that receives the trace of the exchanges, see the trace package
+const traceEnvVar = "LEDGER_TRACE"
+
 const sigLen = 64
 
+const pubKeyLen = 32
+
+// receiverKeysPerAPDU is the count of public keys sent with each P1 of cmdSetPolicy adding receivers
+const receiverKeysPerAPDU = 7
+
+// batchTicketLen is the size of the ticket returned for each transaction of a batch: the
+// transaction hash followed by the previous value of the hash chain kept by the app
+const batchTicketLen = 2 * hashLen
+
+const hashLen = 32
+
+// maxBatchSignCount is the count of batch transactions signed by a single exchange
+const maxBatchSignCount = 4
+
 var (
 	errUserRejected         = errors.New("user denied request")
 	errUnknownInstruction   = errors.New("unknown instruction (INS)")
@@ -79,6 +132,8 @@ var (
 	errInvalidFee           = errors.New("invalid fee")
 	errPrettyFailed         = errors.New("failed to make the amount look pretty")
 	errDataTooLong          = errors.New("data too long")
+	errNotPlainTransfer     = errors.New("not a plain transfer")
+	errSpendingLimit        = errors.New("over the spending limits")
 )
 
 type NanoS struct {
@@ -142,6 +197,10 @@ func (n *NanoS) Exchange(cmd byte, p1, p2, lc byte, data []byte) (resp []byte, e
 		err = errPrettyFailed
 	case codeDataTooLong:
 		err = errDataTooLong
+	case codeNotPlainTransfer:
+		err = errNotPlainTransfer
+	case codeSpendingLimit:
+		err = errSpendingLimit
 	default:
 		err = fmt.Errorf("Error code 0x%x", code)
 	}
@@ -172,6 +231,48 @@ func (n *NanoS) GetConfiguration() error {
 	return nil
 }
 
+// Capabilities lists the protocol features supported by the app and their limits
+type Capabilities struct {
+	Version        uint8
+	Flags          uint32
+	MaxRawBatch    uint8
+	MaxBech32Batch uint8
+	KeyCacheSlots  uint8
+	MaxTxBatch     uint16 // 0 when the app predates batch signing
+	MaxTxQueue     uint8  // 0 when the app predates queued signing
+}
+
+// Has tells if the app supports a Capability* feature
+func (c *Capabilities) Has(capability uint32) bool {
+	return c.Flags&capability != 0
+}
+
+// GetCapabilities retrieves the features supported by the app. Apps predating the command fail
+// with an unknown instruction error: only the basic protocol can be used with them
+func (n *NanoS) GetCapabilities() (*Capabilities, error) {
+	resp, err := n.Exchange(cmdGetCapabilities, 0, 0, 0, nil)
+	if err != nil {
+		return nil, err
+	}
+	if len(resp) < 8 {
+		return nil, errors.New(errBadCapabilitiesResponse)
+	}
+	capabilities := &Capabilities{
+		Version:        resp[0],
+		Flags:          binary.BigEndian.Uint32(resp[1:5]),
+		MaxRawBatch:    resp[5],
+		MaxBech32Batch: resp[6],
+		KeyCacheSlots:  resp[7],
+	}
+	if len(resp) >= 10 {
+		capabilities.MaxTxBatch = binary.BigEndian.Uint16(resp[8:10])
+	}
+	if len(resp) >= 11 {
+		capabilities.MaxTxQueue = resp[10]
+	}
+	return capabilities, nil
+}
+
 // GetAddress retrieves from device the address based on account and address index
 func (n *NanoS) GetAddress(account uint32, index uint32) (pubkey []byte, err error) {
 	return n.getAddress(account, index, p1WithConfirmation)
@@ -277,6 +378,229 @@ func (n *NanoS) sign(txData []byte, cmd byte) (sig []byte, err error) {
 	return
 }
 
+// SignTxBatch sends json marshalized plain transfers to the device, which reviews them at once,
+// and returns their signatures in the same order. The app hands out a ticket for each
+// transaction and signs them from the last one to the first one when the tickets are sent back
+func (n *NanoS) SignTxBatch(txsData [][]byte) (sigs [][]byte, err error) {
+	tickets := make([][]byte, len(txsData))
+	for i, txData := range txsData {
+		buf := bytes.NewBuffer(txData)
+		var p1 byte = p1BatchNextTx
+		if i == 0 {
+			p1 = p1First
+		}
+		var resp []byte
+		for buf.Len() > 0 {
+			toSend := buf.Next(math.MaxUint8)
+			resp, err = n.Exchange(cmdSignTxnBatch, p1, 0, byte(len(toSend)), toSend)
+			if err != nil {
+				return nil, err
+			}
+			p1 = p1More
+		}
+		if len(resp) != batchTicketLen {
+			return nil, errors.New(errBadBatchTicket)
+		}
+		tickets[i] = resp
+	}
+
+	if _, err = n.Exchange(cmdSignTxnBatch, p1BatchReview, 0, 0, nil); err != nil {
+		return nil, err
+	}
+
+	// the hashes of up to maxBatchSignCount transactions, from the last one, and the previous
+	// chain of the earliest of them get their signatures in a single exchange
+	sigs = make([][]byte, len(tickets))
+	for last := len(tickets) - 1; last >= 0; last -= maxBatchSignCount {
+		first := last - maxBatchSignCount + 1
+		if first < 0 {
+			first = 0
+		}
+		var req []byte
+		for i := last; i >= first; i-- {
+			req = append(req, tickets[i][:hashLen]...)
+		}
+		req = append(req, tickets[first][hashLen:]...)
+		resp, err := n.Exchange(cmdSignTxnBatch, p1BatchSign, 0, byte(len(req)), req)
+		if err != nil {
+			return nil, err
+		}
+		count := last - first + 1
+		if len(resp) != 1+count*sigLen || int(resp[0]) != count {
+			return nil, errors.New(errBadSignature)
+		}
+		for i := last; i >= first; i-- {
+			sigs[i] = make([]byte, sigLen)
+			copy(sigs[i], resp[1+(last-i)*sigLen:])
+		}
+	}
+	return sigs, nil
+}
+
+// SignTxQueue uploads json marshalized transactions to the device before they are reviewed one
+// after the other, and returns their signatures in the same order. At most MaxTxQueue of them can
+// be queued, Nano S does not support queues
+func (n *NanoS) SignTxQueue(txsData [][]byte) (sigs [][]byte, err error) {
+	for i, txData := range txsData {
+		buf := bytes.NewBuffer(txData)
+		var p1 byte = p1QueueNextTx
+		if i == 0 {
+			p1 = p1First
+		}
+		for buf.Len() > 0 {
+			toSend := buf.Next(math.MaxUint8)
+			if _, err = n.Exchange(cmdSignTxnQueue, p1, 0, byte(len(toSend)), toSend); err != nil {
+				return nil, err
+			}
+			p1 = p1More
+		}
+	}
+
+	resp, err := n.Exchange(cmdSignTxnQueue, p1QueueReview, 0, 0, nil)
+	if err != nil {
+		return nil, err
+	}
+	if len(resp) != 1+len(txsData)*sigLen || int(resp[0]) != len(txsData) {
+		return nil, errors.New(errBadSignature)
+	}
+	sigs = make([][]byte, len(txsData))
+	for i := range sigs {
+		sigs[i] = make([]byte, sigLen)
+		copy(sigs[i], resp[1+i*sigLen:])
+	}
+	return sigs, nil
+}
+
+// SpendingLimits caps the transactions signed without review over any window consecutive account
+// nonces
+type SpendingLimits struct {
+	Window    uint32
+	MaxAmount *big.Int // value plus fee of all the transactions of a window
+	MaxCount  uint16
+}
+
+// SpendingCounter is what an account spent in the window ending at its last nonce
+type SpendingCounter struct {
+	Account      uint32
+	AddressIndex uint32
+	LastNonce    uint64 // highest nonce counted
+	Amount       *big.Int
+	Count        uint16
+}
+
+func validAmount(amount *big.Int) bool {
+	return amount != nil && amount.Sign() >= 0 && amount.BitLen() <= 128
+}
+
+// amountBytes encodes a valid amount on 16 bytes, big endian
+func amountBytes(amount *big.Int) []byte {
+	b := amount.Bytes()
+	return append(make([]byte, 16-len(b)), b...)
+}
+
+// sortReceivers returns the public keys of the receivers in the order the device keeps them
+func sortReceivers(receiverKeys [][]byte) ([][]byte, error) {
+	sorted := make([][]byte, len(receiverKeys))
+	copy(sorted, receiverKeys)
+	sort.Slice(sorted, func(i, j int) bool {
+		return bytes.Compare(sorted[i], sorted[j]) < 0
+	})
+	for i, key := range sorted {
+		if len(key) != pubKeyLen || (i > 0 && bytes.Equal(key, sorted[i-1])) {
+			return nil, errInvalidArguments
+		}
+	}
+	return sorted, nil
+}
+
+// SetSigningPolicy has the user review a policy on the device. Once approved, the transactions
+// sent to one of the receivers, given by their public keys, for at most maxAmount value plus fee,
+// without guardian nor relayer, and whose data is empty or calls one of the functions by name, are
+// signed by SignTxHash without being reviewed, within the optional spending limits
+func (n *NanoS) SetSigningPolicy(chainID string, maxAmount *big.Int, receiverKeys [][]byte, functions []string, limits *SpendingLimits) error {
+	if len(chainID) > math.MaxUint8 || !validAmount(maxAmount) {
+		return errInvalidArguments
+	}
+	sorted, err := sortReceivers(receiverKeys)
+	if err != nil {
+		return err
+	}
+	begin := append([]byte{byte(len(chainID))}, chainID...)
+	begin = append(begin, amountBytes(maxAmount)...)
+	if limits != nil {
+		if !validAmount(limits.MaxAmount) {
+			return errInvalidArguments
+		}
+		window := make([]byte, 4)
+		binary.BigEndian.PutUint32(window, limits.Window)
+		maxCount := make([]byte, 2)
+		binary.BigEndian.PutUint16(maxCount, limits.MaxCount)
+		begin = append(begin, window...)
+		begin = append(begin, amountBytes(limits.MaxAmount)...)
+		begin = append(begin, maxCount...)
+	}
+	if _, err := n.Exchange(cmdSetPolicy, p1PolicyBegin, 0, byte(len(begin)), begin); err != nil {
+		return err
+	}
+	for len(sorted) > 0 {
+		count := receiverKeysPerAPDU
+		if count > len(sorted) {
+			count = len(sorted)
+		}
+		keys := bytes.Join(sorted[:count], nil)
+		if _, err = n.Exchange(cmdSetPolicy, p1PolicyReceiver, 0, byte(len(keys)), keys); err != nil {
+			return err
+		}
+		sorted = sorted[count:]
+	}
+	for _, function := range functions {
+		if _, err = n.Exchange(cmdSetPolicy, p1PolicyFunction, 0, byte(len(function)), []byte(function)); err != nil {
+			return err
+		}
+	}
+	_, err = n.Exchange(cmdSetPolicy, p1PolicyConfirm, 0, 0, nil)
+	return err
+}
+
+// DisableSigningPolicy turns the signing policy off, every transaction is reviewed again
+func (n *NanoS) DisableSigningPolicy() error {
+	_, err := n.Exchange(cmdSetPolicy, p1PolicyDisable, 0, 0, nil)
+	return err
+}
+
+// GetSpendingLimits returns the spending limits of the signing policy and the counters of the
+// accounts that signed transactions without review. The counters restart from values kept ahead
+// of the spending after the app restarts
+func (n *NanoS) GetSpendingLimits() (limits *SpendingLimits, counters []SpendingCounter, err error) {
+	const headerLen = 4 + 16 + 2 + 1
+	const counterLen = 4 + 4 + 8 + 16 + 2
+
+	resp, err := n.Exchange(cmdGetSpendingLimits, 0, 0, 0, nil)
+	if err != nil {
+		return nil, nil, err
+	}
+	if len(resp) < headerLen || len(resp) != headerLen+int(resp[headerLen-1])*counterLen {
+		return nil, nil, errors.New(errBadSpendingResponse)
+	}
+	limits = &SpendingLimits{
+		Window:    binary.BigEndian.Uint32(resp[0:4]),
+		MaxAmount: new(big.Int).SetBytes(resp[4:20]),
+		MaxCount:  binary.BigEndian.Uint16(resp[20:22]),
+	}
+	counters = make([]SpendingCounter, resp[headerLen-1])
+	for i := range counters {
+		c := resp[headerLen+i*counterLen:]
+		counters[i] = SpendingCounter{
+			Account:      binary.BigEndian.Uint32(c[0:4]),
+			AddressIndex: binary.BigEndian.Uint32(c[4:8]),
+			LastNonce:    binary.BigEndian.Uint64(c[8:16]),
+			Amount:       new(big.Int).SetBytes(c[16:32]),
+			Count:        binary.BigEndian.Uint16(c[32:34]),
+		}
+	}
+	return limits, counters, nil
+}
+
 // SignMsg sends a message to the device and returns the signature
 func (n *NanoS) SignMsg(msg string) (sig []byte, err error) {
 	buf := new(bytes.Buffer)
@@ -312,13 +636,27 @@ func OpenNanoS() (*NanoS, error) {
 	}
 
 	// wrap raw device I/O in HID+APDU protocols
-	return &NanoS{
+	nanos := &NanoS{
 		device: &apduFramer{
 			hf: &hidFramer{
 				rw: device,
 			},
 		},
-	}, nil
+	}
+
+	if path := os.Getenv(traceEnvVar); path != "" {
+		file, err := os.Create(path)
+		if err != nil {
+			return nil, err
+		}
+		nanos.SetTraceRecorder(trace.NewRecorder(file))
+	}
+	return nanos, nil
+}
+
+// SetTraceRecorder records the following exchanges with the device, nil stops the recording
+func (n *NanoS) SetTraceRecorder(recorder *trace.Recorder) {
+	n.device.recorder = recorder
 }
 
 func (n *NanoS) ProvideESDTInfo(info []byte) error {
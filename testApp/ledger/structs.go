@@ -6,6 +6,9 @@ import (
 	"encoding/hex"
 	"fmt"
 	"io"
+	"time"
+
+	"github.com/ElrondNetwork/ledger-elrond/testApp/trace"
 )
 
 const (
@@ -36,8 +39,9 @@ type APDU struct {
 }
 
 type apduFramer struct {
-	hf  *hidFramer
-	buf [2]byte // to read APDU length prefix
+	hf       *hidFramer
+	buf      [2]byte         // to read APDU length prefix
+	recorder *trace.Recorder // records every exchange when set
 }
 
 // Reset resets the communication with the device
@@ -113,6 +117,7 @@ func (af *apduFramer) Exchange(apdu APDU) ([]byte, error) {
 		apdu.P1, apdu.P2,
 		apdu.LC,
 	}, apdu.DATA...)
+	start := time.Now()
 	if _, err := af.hf.Write(data); err != nil {
 		return nil, err
 	}
@@ -128,5 +133,8 @@ func (af *apduFramer) Exchange(apdu APDU) ([]byte, error) {
 	if debug {
 		fmt.Println("HID =>", hex.EncodeToString(resp))
 	}
+	if err == nil && af.recorder != nil {
+		err = af.recorder.Record(data, resp, start, time.Since(start))
+	}
 	return resp, err
 }
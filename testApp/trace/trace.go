@@ -0,0 +1,114 @@
+// Package trace records the APDUs exchanged with the app, so that the same
+// traffic can later be replayed against Speculos or the host simulation build.
+//
+// A trace is a JSON Lines file, one exchange per line:
+//
+//	{"time":"2024-05-02T10:04:05.123456789Z","apdu":"ed01000000","response":"312e312e309000","duration_ns":1234567}
+//
+// apdu is the command as sent, header included, and response holds the data
+// followed by the status word, both in hex.
+package trace
+
+import (
+	"bufio"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"io"
+	"sync"
+	"time"
+)
+
+const (
+	errShortAPDU     = "APDU shorter than its header"
+	errBadTraceEntry = "trace line %d: %v"
+
+	// large enough for any APDU and its response written in hex
+	maxLineSize = 1 << 20
+)
+
+// Entry is one exchange of a trace
+type Entry struct {
+	Time       time.Time `json:"time"`
+	APDU       HexBytes  `json:"apdu"`
+	Response   HexBytes  `json:"response"`
+	DurationNs int64     `json:"duration_ns"`
+}
+
+// HexBytes is a byte slice marshalled as a hex string
+type HexBytes []byte
+
+// MarshalJSON encodes the bytes as a hex string
+func (h HexBytes) MarshalJSON() ([]byte, error) {
+	return json.Marshal(hex.EncodeToString(h))
+}
+
+// UnmarshalJSON decodes a hex string
+func (h *HexBytes) UnmarshalJSON(data []byte) error {
+	var s string
+	if err := json.Unmarshal(data, &s); err != nil {
+		return err
+	}
+	decoded, err := hex.DecodeString(s)
+	if err != nil {
+		return err
+	}
+	*h = decoded
+	return nil
+}
+
+// INS returns the instruction byte of an entry returned by Read
+func (e *Entry) INS() byte {
+	return e.APDU[1]
+}
+
+// Duration returns the time the device took to answer
+func (e *Entry) Duration() time.Duration {
+	return time.Duration(e.DurationNs)
+}
+
+// Recorder appends exchanges to a trace, it is safe for concurrent use
+type Recorder struct {
+	mu      sync.Mutex
+	encoder *json.Encoder
+}
+
+// NewRecorder returns a recorder writing the trace to w
+func NewRecorder(w io.Writer) *Recorder {
+	return &Recorder{encoder: json.NewEncoder(w)}
+}
+
+// Record appends one exchange, started at start and answered after duration
+func (r *Recorder) Record(apdu, response []byte, start time.Time, duration time.Duration) error {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	return r.encoder.Encode(Entry{
+		Time:       start.UTC(),
+		APDU:       apdu,
+		Response:   response,
+		DurationNs: duration.Nanoseconds(),
+	})
+}
+
+// Read parses a whole trace, skipping blank lines
+func Read(r io.Reader) ([]Entry, error) {
+	var entries []Entry
+	scanner := bufio.NewScanner(r)
+	scanner.Buffer(make([]byte, 64*1024), maxLineSize)
+	line := 0
+	for scanner.Scan() {
+		line++
+		if len(scanner.Bytes()) == 0 {
+			continue
+		}
+		var entry Entry
+		if err := json.Unmarshal(scanner.Bytes(), &entry); err != nil {
+			return nil, fmt.Errorf(errBadTraceEntry, line, err)
+		}
+		if len(entry.APDU) < 5 {
+			return nil, fmt.Errorf(errBadTraceEntry, line, errShortAPDU)
+		}
+		entries = append(entries, entry)
+	}
+	return entries, scanner.Err()
+}
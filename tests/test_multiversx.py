@@ -25,6 +25,8 @@ import sys
 from enum import IntEnum
 from pathlib import Path
 
+from Crypto.Hash import keccak
+from Crypto.Signature import eddsa
 from ragger.navigator import NavInsID, NavIns
 from ragger.backend.interface import RAPDU, RaisePolicy
 from .utils import get_version_from_makefile
@@ -44,6 +46,13 @@ class Ins(IntEnum):
     SIGN_TX_HASH = 0x07
     PROVIDE_ESDT_INFO = 0x08  # TODO add test for this APDU
     SIGN_MSG_AUTH_TOKEN = 0x09
+    SIGN_TX_HASH_ONLY = 0x0A
+    GET_ADDR_BATCH = 0x0B
+    GET_CAPABILITIES = 0x0D
+    SIGN_TX_BATCH = 0x0E
+    SIGN_TX_QUEUE = 0x0F
+    SET_POLICY = 0x10
+    GET_SPENDING_LIMITS = 0x11
 
 
 class P1(IntEnum):
@@ -56,6 +65,9 @@ class P1(IntEnum):
 class P2(IntEnum):
     DISPLAY_BECH32 = 0x00
     DISPLAY_HEX = 0x01
+    BATCH_RAW = 0x00
+    BATCH_BECH32 = 0x01
+    RETURN_HASH = 0x01
 
 
 class Error(IntEnum):
@@ -77,6 +89,9 @@ class Error(IntEnum):
     INVALID_AMOUNT = 0x6E0B
     INVALID_FEE = 0x6E0C
     PRETTY_FAILED = 0x6E0D
+    HASH_SIGNING_DISABLED = 0x6E15
+    NOT_PLAIN_TRANSFER = 0x6E16
+    SPENDING_LIMIT = 0x6E17
 
 
 MAX_SIZE = 251
@@ -84,18 +99,18 @@ ROOT_SCREENSHOT_PATH = Path(__file__).parent.resolve()
 
 
 @contextmanager
-def send_async_sign_message(backend, ins, payload: bytes) -> Generator[None, None, None]:
+def send_async_sign_message(backend, ins, payload: bytes, p2: int = 0) -> Generator[None, None, None]:
     payload_splited = [payload[x:x + MAX_SIZE] for x in range(0, len(payload), MAX_SIZE)]
     p1 = P1.FIRST
     if len(payload_splited) > 1:
         for p in payload_splited[:-1]:
-            backend.exchange(CLA, ins, p1, 0, p)
+            backend.exchange(CLA, ins, p1, p2, p)
             p1 = P1.MORE
 
     with backend.exchange_async(CLA,
                                 ins,
                                 p1,
-                                0,
+                                p2,
                                 payload_splited[-1]):
         yield
 
@@ -110,6 +125,7 @@ class TestMenu:
                        NavInsID.RIGHT_CLICK,
                        NavInsID.BOTH_CLICK,
                        NavInsID.RIGHT_CLICK,
+                       NavInsID.RIGHT_CLICK,
                        NavInsID.BOTH_CLICK,
                        NavInsID.RIGHT_CLICK,
                        NavInsID.RIGHT_CLICK,
@@ -156,6 +172,21 @@ class TestGetAppConfiguration:
         # data[6:10] is the bip32_account
         # data[10:14] is the bip32_address_index
 
+    def test_get_capabilities(self, backend):
+        data = backend.exchange(CLA, Ins.GET_CAPABILITIES, 0, 0, b"").data
+        assert len(data) >= 11
+        assert data[0] == 1  # version
+        capabilities = int.from_bytes(data[1:5], "big")
+        assert capabilities & 0x6B == 0x6B  # all but hash signing, perf counters and policy
+        assert capabilities & 0x04 == 0  # hash signing is disabled by default
+        assert capabilities & 0x80 == 0  # no signing policy by default
+        assert data[5] == 8  # max batch of raw public keys
+        assert data[6] == 4  # max batch of bech32 addresses
+        assert data[7] == 1  # key cache slots
+        assert int.from_bytes(data[8:10], "big") == 1000  # max transaction batch
+        # max transaction queue, Nano S has no RAM for it
+        assert data[10] == (0 if backend.firmware.device == "nanos" else 4)
+
     def test_toggle_contract_data(self, backend, navigator, test_name):
         # init enabled
         assert backend.exchange(CLA, Ins.GET_APP_CONFIGURATION, P1.FIRST, 0, b"").data[0] == 1
@@ -249,6 +280,30 @@ class TestGetAddr:
         rapdu = backend.exchange(CLA, Ins.GET_ADDR, P1.NON_CONFIRM, P2.DISPLAY_HEX, payload)
         assert rapdu.status == Error.INVALID_ARGUMENTS
 
+    def test_get_addr_batch_raw(self, backend):
+        account = 1
+        start = 3
+        count = 4
+        payload = account.to_bytes(4, "big") + start.to_bytes(4, "big") + count.to_bytes(1, "big")
+        data = backend.exchange(CLA, Ins.GET_ADDR_BATCH, 0, P2.BATCH_RAW, payload).data
+        assert len(data) == 32 * count
+        for i in range(count):
+            payload = account.to_bytes(4, "big") + (start + i).to_bytes(4, "big")
+            single = backend.exchange(CLA, Ins.GET_ADDR, P1.NON_CONFIRM, P2.DISPLAY_HEX, payload).data
+            assert data[32 * i:32 * (i + 1)].hex() == single[1:].decode("ascii")
+
+    def test_get_addr_batch_bech32(self, backend):
+        count = 4
+        payload = int(0).to_bytes(4, "big") * 2 + count.to_bytes(1, "big")
+        data = backend.exchange(CLA, Ins.GET_ADDR_BATCH, 0, P2.BATCH_BECH32, payload).data
+        assert re.match("^(erd1[0-9a-z]{58}){4}$", data.decode("ascii"))
+
+    def test_get_addr_batch_count_too_big(self, backend):
+        payload = int(0).to_bytes(4, "big") * 2 + int(9).to_bytes(1, "big")
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.GET_ADDR_BATCH, 0, P2.BATCH_RAW, payload)
+        assert rapdu.status == Error.INVALID_ARGUMENTS
+
 
 class TestSignTx:
 
@@ -335,6 +390,62 @@ class TestSignMsg:
 
 class TestSignTxHash:
 
+    def test_sign_tx_return_hash(self, backend, navigator, test_name):
+        account = 0
+        index = 0
+        payload = account.to_bytes(4, "big") + index.to_bytes(4, "big")
+        public_key = backend.exchange(CLA, Ins.GET_ADDR, P1.NON_CONFIRM, P2.DISPLAY_HEX, payload).data
+        public_key = bytes.fromhex(public_key[1:].decode("ascii"))
+
+        payload = b'{"nonce":1234,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}'
+        with send_async_sign_message(backend, Ins.SIGN_TX_HASH, payload, P2.RETURN_HASH):
+            if backend.firmware.device.startswith("nano"):
+                navigator.navigate_until_text_and_compare(NavInsID.RIGHT_CLICK,
+                                                          [NavInsID.BOTH_CLICK],
+                                                          "Sign transaction",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+            elif backend.firmware.device == "stax":
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavInsID.USE_CASE_REVIEW_CONFIRM,
+                                                           NavInsID.USE_CASE_STATUS_DISMISS],
+                                                          "Hold to sign",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+        data = backend.last_async_response.data
+        assert len(data) == 1 + 64 + 1 + 32
+        assert data[0] == 64
+        assert data[65] == 32
+
+        # with the hash signing option the signature is over the keccak hash of the transaction
+        tx_hash = keccak.new(digest_bits=256, data=payload).digest()
+        assert data[66:98] == tx_hash
+        verifier = eddsa.new(eddsa.import_public_key(public_key), "rfc8032")
+        verifier.verify(tx_hash, data[1:65])  # raises ValueError if the signature does not match
+
+    def test_sign_tx_field_name_prefix(self, backend):
+        payload = b'{"nonce":1234,"valueX":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}'
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+    def test_sign_tx_data_not_carried_over(self, backend):
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        # the data field of the first transaction is decoded before the invalid field is met
+        payload = b'{"nonce":1234,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":5000000,"data":"c2VjcmV0IHRyYW5zZmVyIHRvIGF0dGFja2Vy","valueX":"1"}'
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.INVALID_MESSAGE
+        # a data field that is not a string would show what was decoded from the previous one
+        payload = b'{"nonce":1234,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":5000000,"data":7,"chainID":"1","version":2,"options":1}'
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+    def test_sign_tx_invalid_p2(self, backend):
+        payload = b'{"nonce":1234,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}'
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0x02, payload)
+        assert rapdu.status == Error.INVALID_ARGUMENTS
+
     def test_sign_tx_valid_simple_no_data_confirmed(self, backend, navigator, test_name):
         payload = b'{"nonce":1234,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}'
         with send_async_sign_message(backend, Ins.SIGN_TX_HASH, payload):
@@ -651,6 +762,449 @@ class TestSignTxHash:
         assert backend.last_async_response.status == Error.INVALID_FEE
 
 
+class TestSignTxHashOnly:
+
+    def test_sign_tx_hash_only_disabled(self, backend):
+        payload = bytes(32)  # transaction hash computed by the host
+        payload += b'{"value":"5678","receiver":"efgh","gasPrice":50000,"gasLimit":20,"chainID":"1"}'
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH_ONLY, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.HASH_SIGNING_DISABLED
+
+    def test_sign_tx_hash_only_more_without_first(self, backend):
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH_ONLY, P1.MORE, 0, b'"}')
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+
+class TestSignTxBatch:
+
+    BATCH_NEXT_TX = 0x01
+    BATCH_REVIEW = 0x02
+    BATCH_SIGN = 0x03
+
+    ALICE = "erd1qyu5wthldzr8wx5c9ucg8kjagg0jfs53s8nr3zpz3hypefsdd8ssycr6th"
+    BOB = "erd1spyavw0956vq68xj8y4tenjpq2wd5a9p2c6j8gsz7ztyrnpxrruqzu66jx"
+
+    @staticmethod
+    def transfer(nonce: int, value: str, receiver: str, data: str = None) -> bytes:
+        tx = {"nonce": nonce, "value": value, "receiver": receiver, "sender": "abcd",
+              "gasPrice": 1000000000, "gasLimit": 50000, "chainID": "1", "version": 2, "options": 1}
+        if data is not None:
+            tx["data"] = data
+        return json.dumps(tx, separators=(",", ":")).encode()
+
+    def test_sign_tx_batch_confirmed(self, backend, navigator, test_name):
+        transfers = [self.transfer(1, "1000000000000000000", self.ALICE),
+                     self.transfer(2, "2500000000000000000", self.BOB),
+                     self.transfer(3, "3", self.ALICE)]
+        tickets = []
+        for i, payload in enumerate(transfers):
+            # the second chunk of each transaction is sent with P1.MORE
+            first = P1.FIRST if i == 0 else self.BATCH_NEXT_TX
+            assert len(backend.exchange(CLA, Ins.SIGN_TX_BATCH, first, 0, payload[:60]).data) == 0
+            ticket = backend.exchange(CLA, Ins.SIGN_TX_BATCH, P1.MORE, 0, payload[60:]).data
+            assert len(ticket) == 64
+            tickets.append(ticket)
+        assert tickets[0][32:] == bytes(32)
+
+        with backend.exchange_async(CLA, Ins.SIGN_TX_BATCH, self.BATCH_REVIEW, 0, b""):
+            if backend.firmware.device.startswith("nano"):
+                navigator.navigate_until_text_and_compare(NavInsID.RIGHT_CLICK,
+                                                          [NavInsID.BOTH_CLICK],
+                                                          "Sign all",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+            elif backend.firmware.device == "stax":
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavInsID.USE_CASE_REVIEW_CONFIRM,
+                                                           NavInsID.USE_CASE_STATUS_DISMISS],
+                                                          "Hold to sign",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+        assert backend.last_async_response.status == 0x9000
+
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        # the tickets are only accepted from the last one to the first one
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, self.BATCH_SIGN, 0, tickets[0])
+        assert rapdu.status == Error.INVALID_MESSAGE
+        # the last two transactions at once: their hashes, then the previous chain of the earliest
+        payload = tickets[2][:32] + tickets[1][:32] + tickets[1][32:]
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, self.BATCH_SIGN, 0, payload)
+        assert rapdu.status == 0x9000
+        assert rapdu.data[0] == 2
+        assert len(rapdu.data) == 1 + 2 * 64
+        # then the first one with its ticket
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, self.BATCH_SIGN, 0, tickets[0])
+        assert rapdu.status == 0x9000
+        assert rapdu.data[0] == 1
+        assert len(rapdu.data) == 1 + 64
+        # the batch is over once every transaction is signed
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, self.BATCH_SIGN, 0, tickets[0])
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+    def test_sign_tx_batch_other_ins(self, backend):
+        # any other command drops the batch
+        backend.exchange(CLA, Ins.SIGN_TX_BATCH, P1.FIRST, 0, self.transfer(1, "5678", self.ALICE))
+        backend.exchange(CLA, Ins.GET_APP_VERSION, 0, 0, b"")
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, self.BATCH_REVIEW, 0, b"")
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+    def test_sign_tx_batch_data_rejected(self, backend):
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        payload = self.transfer(1, "5678", self.ALICE, "dGVzdA==")
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.NOT_PLAIN_TRANSFER
+        # the batch was dropped
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, self.BATCH_REVIEW, 0, b"")
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+    def test_sign_tx_batch_invalid_receiver(self, backend):
+        # receivers are counted by public key, a receiver that is no address cannot be
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        payload = self.transfer(1, "5678", "efgh")
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.NOT_PLAIN_TRANSFER
+
+
+class TestSignTxQueue:
+
+    QUEUE_NEXT_TX = 0x01
+    QUEUE_REVIEW = 0x02
+
+    def test_sign_tx_queue_nanos(self, backend):
+        if backend.firmware.device != "nanos":
+            pytest.skip("only Nano S leaves the queue out")
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        payload = b'{"nonce":1,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}'
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_QUEUE, P1.FIRST, 0, payload)
+        assert rapdu.status == Error.UNKNOWN_INSTRUCTION
+
+    def test_sign_tx_queue_confirmed(self, backend, navigator, test_name):
+        if backend.firmware.device == "nanos":
+            pytest.skip("the queue is not available on Nano S")
+        transfers = [b'{"nonce":1,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}',
+                     b'{"nonce":2,"value":"1234","receiver":"ijkl","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1,"data":"test"}']
+        for i, payload in enumerate(transfers):
+            first = P1.FIRST if i == 0 else self.QUEUE_NEXT_TX
+            backend.exchange(CLA, Ins.SIGN_TX_QUEUE, first, 0, payload[:60])
+            assert len(backend.exchange(CLA, Ins.SIGN_TX_QUEUE, P1.MORE, 0, payload[60:]).data) == 0
+
+        with backend.exchange_async(CLA, Ins.SIGN_TX_QUEUE, self.QUEUE_REVIEW, 0, b""):
+            # the reviews follow each other, the last one ends with the status screen
+            if backend.firmware.device.startswith("nano"):
+                for i in range(len(transfers)):
+                    navigator.navigate_until_text_and_compare(NavInsID.RIGHT_CLICK,
+                                                              [NavInsID.BOTH_CLICK],
+                                                              "Sign transaction",
+                                                              ROOT_SCREENSHOT_PATH,
+                                                              test_name + "_%d" % i)
+            elif backend.firmware.device == "stax":
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavInsID.USE_CASE_REVIEW_CONFIRM],
+                                                          "Hold to sign",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name + "_0")
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavInsID.USE_CASE_REVIEW_CONFIRM,
+                                                           NavInsID.USE_CASE_STATUS_DISMISS],
+                                                          "Hold to sign",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name + "_1")
+        data = backend.last_async_response.data
+        assert data[0] == len(transfers)
+        assert len(data) == 1 + 64 * len(transfers)
+
+    def test_sign_tx_queue_full(self, backend):
+        if backend.firmware.device == "nanos":
+            pytest.skip("the queue is not available on Nano S")
+        payload = b'{"nonce":1,"value":"5678","receiver":"efgh","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","version":2,"options":1}'
+        backend.exchange(CLA, Ins.SIGN_TX_QUEUE, P1.FIRST, 0, payload)
+        for _ in range(3):
+            backend.exchange(CLA, Ins.SIGN_TX_QUEUE, self.QUEUE_NEXT_TX, 0, payload)
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_QUEUE, self.QUEUE_NEXT_TX, 0, payload)
+        assert rapdu.status == Error.MESSAGE_TOO_LONG
+
+
+class TestSigningPolicy:
+
+    POLICY_BEGIN = 0x00
+    POLICY_ADD_RECEIVER = 0x01
+    POLICY_ADD_FUNCTION = 0x02
+    POLICY_CONFIRM = 0x03
+    POLICY_DISABLE = 0x04
+
+    # the policy allows receivers by public key, the transactions name them by address
+    RECEIVER_KEY = bytes.fromhex("0139472eff6886771a982f3083da5d421f24c29181e63888228dc81ca60d69e1")
+    RECEIVER = "erd1qyu5wthldzr8wx5c9ucg8kjagg0jfs53s8nr3zpz3hypefsdd8ssycr6th"
+    OTHER_RECEIVER = "erd1spyavw0956vq68xj8y4tenjpq2wd5a9p2c6j8gsz7ztyrnpxrruqzu66jx"
+    MAX_AMOUNT = 10**18
+
+    @staticmethod
+    def transfer(nonce: int = 1, value: str = "5678", receiver: str = RECEIVER, chain_id: str = "1",
+                 data: str = None) -> bytes:
+        tx = {"nonce": nonce, "value": value, "receiver": receiver, "sender": "abcd",
+              "gasPrice": 50000, "gasLimit": 20, "chainID": chain_id, "version": 2, "options": 1}
+        if data is not None:
+            tx["data"] = data
+        return json.dumps(tx, separators=(",", ":")).encode()
+
+    def begin_policy(self, backend, receiver_keys: List[bytes] = None, functions: List[bytes] = (),
+                     limits: bytes = b""):
+        max_amount = self.MAX_AMOUNT.to_bytes(16, "big")
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_BEGIN, 0, b"\x011" + max_amount + limits)
+        keys = b"".join(receiver_keys or [self.RECEIVER_KEY])
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_RECEIVER, 0, keys)
+        for function in functions:
+            backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_FUNCTION, 0, function)
+
+    def enable_policy(self, backend, navigator, test_name):
+        with backend.exchange_async(CLA, Ins.SET_POLICY, self.POLICY_CONFIRM, 0, b""):
+            if backend.firmware.device.startswith("nano"):
+                navigator.navigate_until_text_and_compare(NavInsID.RIGHT_CLICK,
+                                                          [NavInsID.BOTH_CLICK],
+                                                          "Enable policy",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name + "_policy")
+            elif backend.firmware.device == "stax":
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavInsID.USE_CASE_REVIEW_CONFIRM,
+                                                           NavInsID.USE_CASE_STATUS_DISMISS],
+                                                          "Hold to enable",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name + "_policy")
+        assert backend.last_async_response.status == 0x9000
+
+    @staticmethod
+    def sign_reviewed(backend, navigator, test_name, ins, payload: bytes):
+        # the transaction only gets its signature once approved on screen
+        with send_async_sign_message(backend, ins, payload):
+            if backend.firmware.device.startswith("nano"):
+                navigator.navigate_until_text_and_compare(NavInsID.RIGHT_CLICK,
+                                                          [NavInsID.BOTH_CLICK],
+                                                          "Sign transaction",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+            elif backend.firmware.device == "stax":
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavInsID.USE_CASE_REVIEW_CONFIRM,
+                                                           NavInsID.USE_CASE_STATUS_DISMISS],
+                                                          "Hold to sign",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+        assert backend.last_async_response.status == 0x9000
+
+    def test_signing_policy_confirmed(self, backend, navigator, test_name):
+        self.begin_policy(backend, functions=[b"test"])
+        self.enable_policy(backend, navigator, test_name)
+        capabilities = backend.exchange(CLA, Ins.GET_CAPABILITIES, 0, 0, b"").data[1:5]
+        assert int.from_bytes(capabilities, "big") & 0x80 == 0x80
+
+        # a matching transaction is signed right away
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, self.transfer(data="dGVzdEAwMQ=="))
+        assert rapdu.data[0] == 64
+        assert len(rapdu.data) == 1 + 64
+
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+        capabilities = backend.exchange(CLA, Ins.GET_CAPABILITIES, 0, 0, b"").data[1:5]
+        assert int.from_bytes(capabilities, "big") & 0x80 == 0
+
+    def test_signing_policy_other_receiver(self, backend, navigator, test_name):
+        self.begin_policy(backend)
+        self.enable_policy(backend, navigator, test_name)
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH,
+                           self.transfer(receiver=self.OTHER_RECEIVER))
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_other_chain_id(self, backend, navigator, test_name):
+        self.begin_policy(backend)
+        self.enable_policy(backend, navigator, test_name)
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH, self.transfer(chain_id="D"))
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_over_max_amount(self, backend, navigator, test_name):
+        self.begin_policy(backend)
+        self.enable_policy(backend, navigator, test_name)
+        # the value alone is at the maximum, the fee takes the transaction over it
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH,
+                           self.transfer(value=str(self.MAX_AMOUNT)))
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_other_data(self, backend, navigator, test_name):
+        self.begin_policy(backend, functions=[b"test"])
+        self.enable_policy(backend, navigator, test_name)
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH,
+                           self.transfer(data="dGVzdGluZw=="))  # "testing", not "test"
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_hash_only(self, backend, navigator, test_name):
+        # enable hash signing
+        if backend.firmware.device.startswith("nano"):
+            nav_ins = [NavInsID.RIGHT_CLICK,
+                       NavInsID.BOTH_CLICK,
+                       NavInsID.RIGHT_CLICK,
+                       NavInsID.BOTH_CLICK,
+                       NavInsID.RIGHT_CLICK,
+                       NavInsID.BOTH_CLICK]
+        elif backend.firmware.device == "stax":
+            nav_ins = [NavInsID.USE_CASE_HOME_SETTINGS,
+                       NavIns(NavInsID.TOUCH, (350, 250)),
+                       NavInsID.USE_CASE_SETTINGS_MULTI_PAGE_EXIT]
+        navigator.navigate_and_compare(ROOT_SCREENSHOT_PATH, test_name + "_settings", nav_ins,
+                                       screen_change_before_first_instruction=False)
+
+        self.begin_policy(backend)
+        self.enable_policy(backend, navigator, test_name)
+        # a hash computed by the host is never signed without review, even for a matching transaction
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH_ONLY,
+                           bytes(32) + self.transfer())
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_guardian(self, backend, navigator, test_name):
+        self.begin_policy(backend)
+        self.enable_policy(backend, navigator, test_name)
+        # a guardian or a relayer takes a matching transaction back to the review
+        payload = b'{"nonce":1,"value":"5678","receiver":"' + self.RECEIVER.encode() + \
+            b'","sender":"abcd","gasPrice":50000,"gasLimit":20,"chainID":"1","guardian":"ijkl","version":2,"options":3}'
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH, payload)
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_invalid_function(self, backend):
+        self.begin_policy(backend)
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        # a function is a whole name, without the arguments of the call
+        for function in (b"ESDTTransfer@", b"", b"a" * 33, b"te?t"):
+            rapdu = backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_FUNCTION, 0, function)
+            assert rapdu.status == Error.INVALID_ARGUMENTS
+
+    def test_signing_policy_many_receivers(self, backend, navigator, test_name):
+        # every receiver is shown in the review, the last one is allowed like the first one
+        self.begin_policy(backend, receiver_keys=[self.RECEIVER_KEY] + [bytes([i]) * 32 for i in range(2, 7)])
+        self.enable_policy(backend, navigator, test_name)
+
+        last_receiver = "erd1qcrqvpsxqcrqvpsxqcrqvpsxqcrqvpsxqcrqvpsxqcrqvpsxqcrqwkh39e"
+        payload = self.transfer(receiver=last_receiver)
+        assert len(backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload).data) == 1 + 64
+
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_spending_window(self, backend, navigator, test_name):
+        # at most 2 transactions over a window of 10 nonces
+        limits = (10).to_bytes(4, "big") + (10**18).to_bytes(16, "big") + (2).to_bytes(2, "big")
+        self.begin_policy(backend, limits=limits)
+        self.enable_policy(backend, navigator, test_name)
+
+        for nonce in (7, 8):
+            payload = self.transfer(nonce=nonce)
+            assert len(backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload).data) == 1 + 64
+
+        data = backend.exchange(CLA, Ins.GET_SPENDING_LIMITS, 0, 0, b"").data
+        assert data[:22] == limits
+        assert data[22] == 1  # a single account spent something
+        assert int.from_bytes(data[31:39], "big") == 8  # the last nonce
+        assert int.from_bytes(data[55:57], "big") == 2
+
+        # the window is full, a third transaction gets the usual review
+        self.sign_reviewed(backend, navigator, test_name + "_over_count", Ins.SIGN_TX_HASH,
+                           self.transfer(nonce=9))
+        # a nonce before the last one is never signed without review
+        self.sign_reviewed(backend, navigator, test_name + "_earlier_nonce", Ins.SIGN_TX_HASH,
+                           self.transfer(nonce=6))
+        # the reviewed transactions are not counted
+        data = backend.exchange(CLA, Ins.GET_SPENDING_LIMITS, 0, 0, b"").data
+        assert int.from_bytes(data[31:39], "big") == 8
+        assert int.from_bytes(data[55:57], "big") == 2
+
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_sliding_window(self, backend, navigator, test_name):
+        limits = (10).to_bytes(4, "big") + (10**18).to_bytes(16, "big") + (2).to_bytes(2, "big")
+        self.begin_policy(backend, limits=limits)
+        self.enable_policy(backend, navigator, test_name)
+
+        for nonce in (7, 16, 17):
+            payload = self.transfer(nonce=nonce)
+            assert len(backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload).data) == 1 + 64
+        # the 10 nonces ending at 18 already hold 16 and 17
+        self.sign_reviewed(backend, navigator, test_name, Ins.SIGN_TX_HASH, self.transfer(nonce=18))
+
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_spending_window_batch(self, backend, navigator, test_name):
+        limits = (10).to_bytes(4, "big") + (10**18).to_bytes(16, "big") + (2).to_bytes(2, "big")
+        self.begin_policy(backend, limits=limits)
+        self.enable_policy(backend, navigator, test_name)
+
+        # the transactions of a batch are counted as they arrive, the third one does not fit
+        backend.exchange(CLA, Ins.SIGN_TX_BATCH, P1.FIRST, 0, self.transfer(nonce=1))
+        backend.exchange(CLA, Ins.SIGN_TX_BATCH, TestSignTxBatch.BATCH_NEXT_TX, 0, self.transfer(nonce=2))
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, TestSignTxBatch.BATCH_NEXT_TX, 0, self.transfer(nonce=3))
+        assert rapdu.status == Error.SPENDING_LIMIT
+        # the batch was dropped
+        rapdu = backend.exchange(CLA, Ins.SIGN_TX_BATCH, TestSignTxBatch.BATCH_REVIEW, 0, b"")
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+        # and gave back what it counted
+        data = backend.exchange(CLA, Ins.GET_SPENDING_LIMITS, 0, 0, b"").data
+        assert data[22] == 0
+
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_spending_window_batch_rejected(self, backend, navigator, test_name):
+        limits = (10).to_bytes(4, "big") + (10**18).to_bytes(16, "big") + (2).to_bytes(2, "big")
+        self.begin_policy(backend, limits=limits)
+        self.enable_policy(backend, navigator, test_name)
+
+        backend.exchange(CLA, Ins.SIGN_TX_BATCH, P1.FIRST, 0, self.transfer(nonce=1))
+        backend.exchange(CLA, Ins.SIGN_TX_BATCH, TestSignTxBatch.BATCH_NEXT_TX, 0, self.transfer(nonce=2))
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        with backend.exchange_async(CLA, Ins.SIGN_TX_BATCH, TestSignTxBatch.BATCH_REVIEW, 0, b""):
+            if backend.firmware.device.startswith("nano"):
+                navigator.navigate_until_text_and_compare(NavInsID.RIGHT_CLICK,
+                                                          [NavInsID.BOTH_CLICK],
+                                                          "Reject",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+            elif backend.firmware.device == "stax":
+                navigator.navigate_until_text_and_compare(NavInsID.SWIPE_CENTER_TO_LEFT,
+                                                          [NavIns(NavInsID.TOUCH, (80, 625)),
+                                                           NavInsID.USE_CASE_CHOICE_CONFIRM,
+                                                           NavInsID.USE_CASE_STATUS_DISMISS],
+                                                          "Hold to sign",
+                                                          ROOT_SCREENSHOT_PATH,
+                                                          test_name)
+        assert backend.last_async_response.status == Error.USER_DENIED
+
+        # the rejected batch gave back what it counted, the window is free again
+        data = backend.exchange(CLA, Ins.GET_SPENDING_LIMITS, 0, 0, b"").data
+        assert data[22] == 0
+        for nonce in (1, 2):
+            payload = self.transfer(nonce=nonce)
+            assert len(backend.exchange(CLA, Ins.SIGN_TX_HASH, P1.FIRST, 0, payload).data) == 1 + 64
+
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_DISABLE, 0, b"")
+
+    def test_signing_policy_unsorted_receivers(self, backend):
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_BEGIN, 0, b"\x011" + (10**18).to_bytes(16, "big"))
+        backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_RECEIVER, 0, b"\x02" * 32)
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        # the public keys must come in increasing order
+        rapdu = backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_RECEIVER, 0, b"\x01" * 32)
+        assert rapdu.status == Error.INVALID_ARGUMENTS
+        rapdu = backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_RECEIVER, 0, b"\x03" * 32 + b"\x03" * 32)
+        assert rapdu.status == Error.INVALID_ARGUMENTS
+
+    def test_signing_policy_out_of_order(self, backend):
+        backend.raise_policy = RaisePolicy.RAISE_NOTHING
+        rapdu = backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_ADD_RECEIVER, 0, self.RECEIVER_KEY)
+        assert rapdu.status == Error.INVALID_MESSAGE
+        rapdu = backend.exchange(CLA, Ins.SET_POLICY, self.POLICY_CONFIRM, 0, b"")
+        assert rapdu.status == Error.INVALID_MESSAGE
+
+
 class TestSignMsgAuthToken:
 
     def test_sign_msg_auth_token_ok(self, backend, navigator, test_name):